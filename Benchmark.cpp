@@ -0,0 +1,154 @@
+#include "PluginProcessor.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+// Drives AudioPluginAudioProcessor::processBlock headlessly across the sample
+// rates and block sizes a host may choose and reports, per configuration,
+// the real-time factor (wall time / audio time), the worst single block as a
+// fraction of its deadline and the jitter (standard deviation) of block times.
+//
+//   ./benchmark [results.json] [seconds of audio per configuration]
+//
+// It also times saving and loading the plugin state, and records which ky
+// kernel variant ran (KY_ISA=sse2|avx2|avx512 forces one). Results go to
+// stdout as JSON when no file name is given.
+
+static juce::var measure (double sampleRate, int blockSize, double seconds)
+{
+    AudioPluginAudioProcessor processor;
+    processor.setRateAndBufferSizeDetails (sampleRate, blockSize);
+    processor.prepareToPlay (sampleRate, blockSize);
+
+    const int channels = std::max (processor.getTotalNumInputChannels(),
+                                   processor.getTotalNumOutputChannels());
+    juce::AudioBuffer<float> buffer (channels, blockSize);
+    juce::MidiBuffer midi;
+
+    const int blocks = std::max (1, static_cast<int> (seconds * sampleRate / blockSize));
+    const double deadline = blockSize / sampleRate;
+
+    // one untimed block to fault in the delay lines and wake the pool
+    buffer.clear();
+    processor.processBlock (buffer, midi);
+
+    double total = 0, worst = 0, sumOfSquares = 0;
+    for (int i = 0; i < blocks; ++i)
+    {
+        buffer.clear();
+        auto start = std::chrono::steady_clock::now();
+        processor.processBlock (buffer, midi);
+        auto end = std::chrono::steady_clock::now();
+
+        double elapsed = std::chrono::duration<double> (end - start).count();
+        total += elapsed;
+        worst = std::max (worst, elapsed);
+        sumOfSquares += elapsed * elapsed;
+    }
+
+    const auto arenaBytes = static_cast<juce::int64> (processor.arena.used());
+    processor.releaseResources();
+
+    double mean = total / blocks;
+    double jitter = std::sqrt (std::max (0.0, sumOfSquares / blocks - mean * mean));
+
+    auto* result = new juce::DynamicObject();
+    result->setProperty ("sampleRate", sampleRate);
+    result->setProperty ("blockSize", blockSize);
+    result->setProperty ("blocks", blocks);
+    result->setProperty ("realTimeFactor", mean / deadline);
+    result->setProperty ("meanBlockMicroseconds", mean * 1e6);
+    result->setProperty ("worstBlockMicroseconds", worst * 1e6);
+    result->setProperty ("worstBlockDeadlineFraction", worst / deadline);
+    result->setProperty ("jitterMicroseconds", jitter * 1e6);
+    result->setProperty ("arenaBytes", arenaBytes);
+    return result;
+}
+
+// microseconds to save and load the plugin state, in the binary format and
+// in the XML format older sessions use
+static juce::var measureState (int repeats)
+{
+    AudioPluginAudioProcessor processor;
+
+    auto time = [repeats] (auto&& f)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < repeats; ++i)
+            f();
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::micro> (end - start).count() / repeats;
+    };
+
+    juce::MemoryBlock binary, xml;
+    auto saveBinary = time ([&] { processor.getStateInformation (binary); });
+    auto loadBinary = time ([&] { processor.setStateInformation (binary.getData(), (int) binary.getSize()); });
+    auto saveXml = time ([&]
+    {
+        xml.reset();
+        std::unique_ptr<juce::XmlElement> element (processor.apvts.copyState().createXml());
+        juce::AudioProcessor::copyXmlToBinary (*element, xml);
+    });
+    auto loadXml = time ([&] { processor.setStateInformation (xml.getData(), (int) xml.getSize()); });
+
+    auto* result = new juce::DynamicObject();
+    result->setProperty ("binaryBytes", (int) binary.getSize());
+    result->setProperty ("binarySaveMicroseconds", saveBinary);
+    result->setProperty ("binaryLoadMicroseconds", loadBinary);
+    result->setProperty ("xmlBytes", (int) xml.getSize());
+    result->setProperty ("xmlSaveMicroseconds", saveXml);
+    result->setProperty ("xmlLoadMicroseconds", loadXml);
+    return result;
+}
+
+int main (int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI initialiser;
+
+    const double seconds = argc > 2 ? std::atof (argv[2]) : 10.0;
+
+    juce::Array<juce::var> results;
+    for (double sampleRate : { 44100.0, 48000.0, 96000.0, 192000.0 })
+    {
+        for (int blockSize = 16; blockSize <= 8192; blockSize *= 2)
+        {
+            auto result = measure (sampleRate, blockSize, seconds);
+            std::fprintf (stderr, "%6.0f Hz %5d samples: rtf %.5f worst %.3f of deadline\n",
+                          sampleRate, blockSize,
+                          static_cast<double> (result["realTimeFactor"]),
+                          static_cast<double> (result["worstBlockDeadlineFraction"]));
+            results.add (result);
+        }
+    }
+
+    auto* report = new juce::DynamicObject();
+    report->setProperty ("plugin", JucePlugin_Name);
+    report->setProperty ("version", JucePlugin_VersionString);
+    report->setProperty ("secondsPerConfiguration", seconds);
+    report->setProperty ("isa", ky::name (ky::kernels().isa));
+    report->setProperty ("results", results);
+    report->setProperty ("state", measureState (1000));
+
+   #if KY_PROFILE
+    juce::Array<juce::var> probes;
+    for (const auto& probe : ky::Profile::report())
+    {
+        auto* entry = new juce::DynamicObject();
+        entry->setProperty ("name", juce::String (probe.name));
+        entry->setProperty ("calls", static_cast<juce::int64> (probe.calls));
+        entry->setProperty ("samples", static_cast<juce::int64> (probe.samples));
+        entry->setProperty ("cycles", static_cast<juce::int64> (probe.cycles));
+        probes.add (juce::var (entry));
+    }
+    report->setProperty ("probes", probes);
+   #endif
+
+    auto json = juce::JSON::toString (juce::var (report));
+    if (argc > 1)
+        return juce::File::getCurrentWorkingDirectory().getChildFile (argv[1]).replaceWithText (json) ? 0 : 1;
+
+    std::printf ("%s\n", json.toRawUTF8());
+    return 0;
+}
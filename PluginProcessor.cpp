@@ -17,6 +17,60 @@ static juce::AudioProcessorValueTreeState::ParameterLayout parameters() {
   return {parameter_list.begin(), parameter_list.end()};
 }
 
+// scheduled events
+enum { pluckEvent };
+
+// on the audio thread: move the scheduler through the block once and note
+// where its events fall, for every voice to read; plucks go to the voices
+// in turn
+static void gatherEvents(AudioPluginAudioProcessor& self, int frames) {
+  self.blockEventCount = 0;
+  for (int done = 0; done < frames;) {
+    ky::Event event;
+    while (self.events.due(event)) {
+      if (self.blockEventCount < static_cast<int>(self.blockEvents.size())) {
+        self.blockEvents[static_cast<size_t>(self.blockEventCount++)] = {
+            done, event.id, self.nextVoice,
+            ky::map(ky::uniform(), -1, 1, 200, 2000),
+            ky::map(ky::uniform(), -1, 1, 0.1, 0.9)};
+        self.nextVoice = (self.nextVoice + 1) % AudioPluginAudioProcessor::voiceCount;
+      } else {
+        ++self.droppedEvents;
+        jassertfalse;
+      }
+    }
+    int m = self.events.until(frames - done);
+    self.events.advance(m);
+    done += m;
+  }
+}
+
+// on the pool: each voice only reads the block's events and only writes
+// its own state
+static void renderVoices(void* context, int p, int n, float* out, int frames) {
+  auto& self = *static_cast<AudioPluginAudioProcessor*>(context);
+  for (int v = p; v < AudioPluginAudioProcessor::voiceCount; v += n) {
+    auto& voice = self.voices[v];
+    // run the string uninterrupted up to each of its events, then handle it
+    int next = 0;
+    for (int done = 0; done < frames;) {
+        for (; next < self.blockEventCount && self.blockEvents[next].offset <= done; ++next) {
+            const auto& event = self.blockEvents[next];
+            if (event.id == pluckEvent && event.voice == v) {
+                voice.string.set(event.frequency, event.decay);
+                voice.string.pluck(voice.noise);
+            }
+        }
+        int m = (next < self.blockEventCount ? self.blockEvents[next].offset : frames) - done;
+        KY_PROBE("PluckedString", m);
+        for (int sample = done; sample < done + m; ++sample) {
+            out[sample] += voice.string();
+        }
+        done += m;
+    }
+  }
+}
+
 
 //==============================================================================
 AudioPluginAudioProcessor::AudioPluginAudioProcessor()
@@ -108,16 +162,55 @@ void AudioPluginAudioProcessor::prepareToPlay (double sampleRate, int samplesPer
     // initialisation that you need..
     juce::ignoreUnused (sampleRate, samplesPerBlock);
 
-    delayLine.resize(100000);
+    // lay the delay memory out in one arena; a second call at the same rate
+    // keeps the layout (and the memory) it already has
+    if (sampleRate != arenaRate) {
+        // a string only needs one period of its lowest pluck (200 Hz)
+        const size_t delaySamples = 100000;
+        const size_t stringSamples = ky::PluckedString::samples(200, static_cast<float>(sampleRate));
+
+        // let go of the old carvings before the arena may be replaced
+        delayLine = {};
+        for (auto& voice : voices)
+            voice.string = {};
+
+        arena.reserve(ky::Arena::round(delaySamples * sizeof(float))
+                    + voiceCount * ky::Arena::round(stringSamples * sizeof(float)), true);
+        arena.reset();
+        delayLine.place(arena, delaySamples);
+        for (int v = 0; v < voiceCount; ++v) {
+            voices[v].string.place(arena, stringSamples);
+            voices[v].string.configure(static_cast<float>(sampleRate));
+            voices[v].noise = ky::Noise(static_cast<uint32_t>(v) * 2654435761u + 1u);
+        }
+        arenaRate = sampleRate;
+
+        DBG("arena: " << (int) arena.used() << " of " << (int) arena.size() << " bytes");
+    }
+
+    // a pluck 2.1 times a second
+    events.capacity(8);
+    events.every(sampleRate / 2.1, pluckEvent);
+    // room for every pending event to fall in the same block
+    blockEvents.resize(events.capacity());
 
-    timer.frequency(2.1, 48000);
-    string.resize(48000, 0);
+    // one worker per extra voice, but never more than the spare cores
+    int cores = static_cast<int>(std::thread::hardware_concurrency());
+    pool.start(std::max(0, std::min(voiceCount, cores) - 1), samplesPerBlock);
 }
 
 void AudioPluginAudioProcessor::releaseResources()
 {
     // When playback stops, you can use this as an opportunity to free up any
     // spare memory, etc.
+    pool.stop();
+
+   #if KY_PROFILE
+    for (const auto& probe : ky::Profile::report())
+        DBG (probe.name << ": " << probe.calls << " calls, "
+             << (probe.samples > 0 ? double (probe.cycles) / double (probe.samples) : 0.0)
+             << " cycles per sample");
+   #endif
 }
 
 bool AudioPluginAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
@@ -172,26 +265,23 @@ void AudioPluginAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer,
 
     c.frequency(f, static_cast<float>(getSampleRate()));
 
-    float b[5000];
-    for (int sample = 0; sample < buffer.getNumSamples(); ++sample) {
-        // static ky::Phasor env;
-        // env.frequency(1.0f / 0.5f, static_cast<float>(getSampleRate())); // 0.5 second period
-        // float s = q() * g * (1 - env());
-        // delayLine.write(s + 0.7 * delayLine.read(getSampleRate() * 0.3f));
-        // b[sample] = s + delayLine.read(getSampleRate() * 0.7f);
-
-        //b[sample] = c();
-        if (timer()) {
-            string.set(
-                ky::map(ky::uniform(), -1, 1, 200, 2000),
-                ky::map(ky::uniform(), -1, 1, 0.1, 0.9));
-            string.pluck();
-        }
-        b[sample] = string();
+    // static ky::Phasor env;
+    // env.frequency(1.0f / 0.5f, static_cast<float>(getSampleRate())); // 0.5 second period
+    // float s = q() * g * (1 - env());
+    // delayLine.write(s + 0.7 * delayLine.read(getSampleRate() * 0.3f));
+    // b[sample] = s + delayLine.read(getSampleRate() * 0.7f);
 
-    }
+    //b[sample] = c();
+    if (totalNumInputChannels == 0)
+        return;
+
+    // render straight into the first channel so any block size the host
+    // hands us fits; the other channels get a copy
+    auto* b = buffer.getWritePointer (0);
+    gatherEvents(*this, buffer.getNumSamples());
+    pool.render(renderVoices, this, b, buffer.getNumSamples());
 
-    for (int channel = 0; channel < totalNumInputChannels; ++channel)
+    for (int channel = 1; channel < totalNumInputChannels; ++channel)
     {
         auto* channelData = buffer.getWritePointer (channel);
         juce::ignoreUnused (channelData);
@@ -219,19 +309,69 @@ void AudioPluginAudioProcessor::getStateInformation (juce::MemoryBlock& destData
     // You should use this method to store your parameters in the memory block.
     // You could do that either as raw data, or use the XML or ValueTree classes
     // as intermediaries to make it easy to save and load complex data.
-  auto state = apvts.copyState();
-  std::unique_ptr<juce::XmlElement> xml(state.createXml());
-  copyXmlToBinary(*xml, destData);
+  //
+  // parameters go in a binary "PARM" chunk (see state.h) as entries of
+  // u8 id length, id, f32 plain value; an id too long for its length byte
+  // is left out (and comes back as its default)
+  juce::MemoryBlock parameters;
+  for (auto* p : getParameters()) {
+    if (auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(p)) {
+      auto id = ranged->getParameterID().toStdString();
+      if (id.size() > 255) {
+        jassertfalse;
+        continue;
+      }
+      unsigned char length = static_cast<unsigned char>(id.size());
+      unsigned char value[4];
+      ky::put(value, std::bit_cast<uint32_t>(ranged->convertFrom0to1(ranged->getValue())), 4);
+      parameters.append(&length, 1);
+      parameters.append(id.data(), id.size());
+      parameters.append(value, sizeof(value));
+    }
+  }
+
+  destData.reset();
+  ky::StateWriter<juce::MemoryBlock> writer(destData);
+  writer.chunk("PARM", parameters.getData(), parameters.getSize());
 }
 
 void AudioPluginAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
     // You should use this method to restore your parameters from this memory block,
     // whose contents will have been created by the getStateInformation() call.
-  std::unique_ptr<juce::XmlElement> xmlState(getXmlFromBinary(data, sizeInBytes));
-  if (xmlState.get() != nullptr)
-    if (xmlState->hasTagName(apvts.state.getType()))
-      apvts.replaceState(juce::ValueTree::fromXml(*xmlState));
+  ky::StateReader reader(data, static_cast<size_t>(std::max(sizeInBytes, 0)));
+  if (!reader.valid()) {
+    // sessions saved before the binary format
+    std::unique_ptr<juce::XmlElement> xmlState(getXmlFromBinary(data, sizeInBytes));
+    if (xmlState.get() != nullptr)
+      if (xmlState->hasTagName(apvts.state.getType()))
+        apvts.replaceState(juce::ValueTree::fromXml(*xmlState));
+    return;
+  }
+
+  // like replaceState: parameters the state leaves out go back to their
+  // defaults, and loading is not an edit, so values are set without telling
+  // the host (no automation or undo is recorded; it reads them back after)
+  for (auto* p : getParameters())
+    p->setValue(p->getDefaultValue());
+
+  // payloads are read where they lie; chunks we don't know (from newer
+  // versions) are skipped
+  ky::StateChunk chunk;
+  while (reader.next(chunk)) {
+    if (chunk.is("PARM")) {
+      const unsigned char* at = chunk.data;
+      const unsigned char* end = chunk.data + chunk.size;
+      while (end - at >= 1 && end - at >= 1 + at[0] + 4) {
+        juce::String id(juce::CharPointer_UTF8(reinterpret_cast<const char*>(at + 1)),
+                        juce::CharPointer_UTF8(reinterpret_cast<const char*>(at + 1 + at[0])));
+        float value = std::bit_cast<float>(static_cast<uint32_t>(ky::get(at + 1 + at[0], 4)));
+        if (auto* p = apvts.getParameter(id))
+          p->setValue(p->convertTo0to1(value));
+        at += 1 + at[0] + 4;
+      }
+    }
+  }
 }
 
 //==============================================================================
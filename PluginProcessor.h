@@ -2,6 +2,8 @@
 
 #include <juce_audio_processors/juce_audio_processors.h>
 #include "ky.h"
+#include "pool.h"
+#include "state.h"
 
 //==============================================================================
 class AudioPluginAudioProcessor final : public juce::AudioProcessor
@@ -46,11 +48,33 @@ public:
     
   juce::AudioProcessorValueTreeState apvts;
 
+   // declared before the units whose memory it holds, so it outlives them
+   ky::Arena arena;
+   double arenaRate = 0;
+
    ky::QuasiSaw q;
    ky::Cycle c;
    ky::DelayLine delayLine;
-   ky::PluckedString string;
-   ky::Timer timer;
+   // voices are spread across the render pool; voice v belongs to partition
+   // v % n. Each owns all the state it touches, noise included, so the
+   // partitions can render at once.
+   static constexpr int voiceCount = 4;
+   struct Voice { ky::PluckedString string; ky::Noise noise; };
+   Voice voices[voiceCount];
+   int nextVoice = 0;  // the voice the next pluck goes to
+
+   ky::Scheduler events;
+   ky::RenderPool pool;
+
+   // the events of the current block, taken from the scheduler on the audio
+   // thread before the voices render; offsets are samples into the block
+   // and the pluck settings are drawn there too, since ky::uniform is not
+   // safe to call from the workers. There is room for every pending event
+   // to fire once (see prepareToPlay); any past that are dropped and counted.
+   struct BlockEvent { int offset; int id; int voice; float frequency; float decay; };
+   std::vector<BlockEvent> blockEvents;
+   int blockEventCount = 0;
+   int droppedEvents = 0;
 private:
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioPluginAudioProcessor)
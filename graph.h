@@ -0,0 +1,356 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "ky.h"
+
+namespace ky {
+
+///////////////////////////////////////////////////////////////////////////////
+//// Graph ////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+// A signal graph that is built and compiled on the message thread and run
+// on the audio thread. Compiling sorts the nodes, checks the connections and
+// gives every output port a scratch buffer, reusing a buffer as soon as the
+// last reader of its previous contents has run. The result is a flat
+// Schedule; a Patch swaps schedules in while the audio thread is running.
+
+// Audio ports carry a block of samples; control ports carry one value per
+// block, in the first sample of their buffer
+enum class Port { Audio, Control };
+
+class Node {
+  public:
+  virtual ~Node() = default;
+  virtual std::vector<Port> inputs() const = 0;
+  virtual std::vector<Port> outputs() const = 0;
+  virtual void process(const float* const* in, float* const* out, int n) = 0;
+};
+
+// a ky unit with a float operator()(float) (a filter) or a float
+// operator()() (a source)
+template <typename U>
+class UnitNode : public Node {
+  public:
+  U unit;
+
+  template <typename... Args>
+  explicit UnitNode(Args&&... args) : unit(std::forward<Args>(args)...) {}
+
+  std::vector<Port> inputs() const override {
+    if constexpr (std::is_invocable_r_v<float, U&, float>) {
+      return {Port::Audio};
+    } else {
+      return {};
+    }
+  }
+  std::vector<Port> outputs() const override { return {Port::Audio}; }
+
+  void process(const float* const* in, float* const* out, int n) override {
+    float* y = out[0];
+    if constexpr (std::is_invocable_r_v<float, U&, float>) {
+      const float* x = in[0];
+      for (int i = 0; i < n; ++i) y[i] = unit(x[i]);
+    } else {
+      for (int i = 0; i < n; ++i) y[i] = unit();
+    }
+  }
+};
+
+// a control value set from outside, e.g. from a parameter
+class ValueNode : public Node {
+  public:
+  std::atomic<float> value{0};
+
+  std::vector<Port> inputs() const override { return {}; }
+  std::vector<Port> outputs() const override { return {Port::Control}; }
+  void process(const float* const*, float* const* out, int) override {
+    out[0][0] = value.load(std::memory_order_relaxed);
+  }
+};
+
+// audio times a control value
+class GainNode : public Node {
+  public:
+  std::vector<Port> inputs() const override { return {Port::Audio, Port::Control}; }
+  std::vector<Port> outputs() const override { return {Port::Audio}; }
+  void process(const float* const* in, float* const* out, int n) override {
+    float g = in[1][0];
+    for (int i = 0; i < n; ++i) out[0][i] = in[0][i] * g;
+  }
+};
+
+// the sum of some number of audio inputs
+class MixNode : public Node {
+  int count;
+
+  public:
+  explicit MixNode(int inputs) : count(inputs) {}
+  std::vector<Port> inputs() const override { return std::vector<Port>(count, Port::Audio); }
+  std::vector<Port> outputs() const override { return {Port::Audio}; }
+  void process(const float* const* in, float* const* out, int n) override {
+    std::memcpy(out[0], in[0], sizeof(float) * static_cast<size_t>(n));
+    for (int k = 1; k < count; ++k)
+      for (int i = 0; i < n; ++i) out[0][i] += in[k][i];
+  }
+};
+
+// A compiled graph: nodes in run order with their buffers already bound.
+// Running it only reads and writes the scratch memory it owns.
+class Schedule {
+  friend class Graph;
+
+  struct Step {
+    Node* node;
+    size_t in, out;  // first entry in the pointer tables
+  };
+
+  std::vector<std::shared_ptr<Node>> nodes;  // keeps the nodes alive
+  std::vector<Step> steps;
+  std::vector<const float*> reads;
+  std::vector<float*> writes;
+  std::vector<float*> results;  // the graph outputs
+  std::vector<float> scratch;
+  int block = 0;
+  int buffers = 0;
+
+  public:
+  int maximumBlock() const { return block; }
+  int bufferCount() const { return buffers; }  // peak scratch buffers in use
+  int outputCount() const { return static_cast<int>(results.size()); }
+
+  // render n samples of every graph output; n may be larger than the
+  // block the graph was compiled for
+  void process(float* const* out, int outputs, int n) {
+    for (int done = 0; done < n;) {
+      int m = std::min(block, n - done);
+      for (const Step& step : steps) {
+        step.node->process(reads.data() + step.in, writes.data() + step.out, m);
+      }
+      for (int k = 0; k < outputs; ++k) {
+        if (k < outputCount()) {
+          std::memcpy(out[k] + done, results[static_cast<size_t>(k)], sizeof(float) * static_cast<size_t>(m));
+        } else {
+          std::memset(out[k] + done, 0, sizeof(float) * static_cast<size_t>(m));
+        }
+      }
+      done += m;
+    }
+  }
+};
+
+// Built and compiled on the message thread. Errors (bad ports, mismatched
+// port types, cycles, a block size below 1) throw std::invalid_argument.
+class Graph {
+  struct Wire {
+    int from, output, to, input;
+  };
+  struct Tap {
+    int node, output;
+  };
+
+  std::vector<std::shared_ptr<Node>> nodes;
+  std::vector<Wire> wires;
+  std::vector<Tap> taps;
+
+  public:
+  int add(std::shared_ptr<Node> node) {
+    nodes.push_back(std::move(node));
+    return static_cast<int>(nodes.size()) - 1;
+  }
+
+  template <typename N, typename... Args>
+  int add(Args&&... args) {
+    return add(std::make_shared<N>(std::forward<Args>(args)...));
+  }
+
+  Node& node(int index) { return *nodes.at(static_cast<size_t>(index)); }
+
+  void connect(int from, int output, int to, int input) {
+    Port a = port(from, output, true), b = port(to, input, false);
+    if (a != b) {
+      throw std::invalid_argument("Connected ports have different types");
+    }
+    for (const Wire& w : wires) {
+      if (w.to == to && w.input == input) {
+        throw std::invalid_argument("Input is already connected");
+      }
+    }
+    wires.push_back({from, output, to, input});
+  }
+
+  // make an audio output of a node the next output of the graph
+  void output(int node, int output) {
+    if (port(node, output, true) != Port::Audio) {
+      throw std::invalid_argument("Graph outputs must be audio");
+    }
+    taps.push_back({node, output});
+  }
+
+  std::unique_ptr<Schedule> compile(int maximumBlock) const {
+    if (maximumBlock <= 0) {
+      throw std::invalid_argument("Block size must be positive");
+    }
+    const size_t count = nodes.size();
+
+    // Kahn's algorithm; ties go in the order nodes were added
+    std::vector<int> pending(count, 0), order;
+    for (const Wire& w : wires) ++pending[static_cast<size_t>(w.to)];
+    for (size_t i = 0; i < count; ++i)
+      if (pending[i] == 0) order.push_back(static_cast<int>(i));
+    for (size_t k = 0; k < order.size(); ++k) {
+      for (const Wire& w : wires) {
+        if (w.from == order[k] && --pending[static_cast<size_t>(w.to)] == 0) {
+          order.push_back(w.to);
+        }
+      }
+    }
+    if (order.size() != count) {
+      throw std::invalid_argument("Graph has a cycle");
+    }
+
+    std::vector<size_t> position(count);
+    for (size_t k = 0; k < count; ++k) position[static_cast<size_t>(order[k])] = k;
+
+    // an output's buffer is live from the step that writes it until the
+    // last step that reads it; graph outputs live to the end
+    std::vector<std::vector<size_t>> lastRead(count);
+    for (size_t i = 0; i < count; ++i) lastRead[i].assign(nodes[i]->outputs().size(), position[i]);
+    for (const Wire& w : wires) {
+      size_t& last = lastRead[static_cast<size_t>(w.from)][static_cast<size_t>(w.output)];
+      last = std::max(last, position[static_cast<size_t>(w.to)]);
+    }
+    for (const Tap& t : taps) lastRead[static_cast<size_t>(t.node)][static_cast<size_t>(t.output)] = count;
+
+    // walk the schedule handing out buffers; buffer 0 is all zeros and
+    // feeds inputs that are not connected
+    std::vector<std::vector<int>> assigned(count);
+    std::vector<int> free;
+    std::vector<std::vector<int>> releases(count + 1);
+    int buffers = 1;
+    for (size_t k = 0; k < count; ++k) {
+      size_t i = static_cast<size_t>(order[k]);
+      // buffers whose last reader ran before this step may be reused
+      free.insert(free.end(), releases[k].begin(), releases[k].end());
+      for (size_t o = 0; o < lastRead[i].size(); ++o) {
+        int buffer;
+        if (free.empty()) {
+          buffer = buffers++;
+        } else {
+          buffer = free.back();
+          free.pop_back();
+        }
+        assigned[i].push_back(buffer);
+        releases[std::min(lastRead[i][o] + 1, count)].push_back(buffer);
+      }
+    }
+
+    auto schedule = std::make_unique<Schedule>();
+    schedule->nodes = nodes;
+    schedule->block = maximumBlock;
+    schedule->buffers = buffers;
+    schedule->scratch.assign(static_cast<size_t>(buffers) * static_cast<size_t>(maximumBlock), 0.0f);
+    auto buffer = [&](int b) { return schedule->scratch.data() + static_cast<size_t>(b) * static_cast<size_t>(maximumBlock); };
+
+    for (int n : order) {
+      size_t i = static_cast<size_t>(n);
+      Schedule::Step step{nodes[i].get(), schedule->reads.size(), schedule->writes.size()};
+      size_t inputs = nodes[i]->inputs().size();
+      for (size_t p = 0; p < inputs; ++p) {
+        const float* source = buffer(0);
+        for (const Wire& w : wires) {
+          if (w.to == n && static_cast<size_t>(w.input) == p) {
+            source = buffer(assigned[static_cast<size_t>(w.from)][static_cast<size_t>(w.output)]);
+          }
+        }
+        schedule->reads.push_back(source);
+      }
+      for (int b : assigned[i]) schedule->writes.push_back(buffer(b));
+      schedule->steps.push_back(step);
+    }
+    for (const Tap& t : taps) {
+      schedule->results.push_back(buffer(assigned[static_cast<size_t>(t.node)][static_cast<size_t>(t.output)]));
+    }
+    return schedule;
+  }
+
+  private:
+  Port port(int node, int index, bool output) const {
+    if (node < 0 || static_cast<size_t>(node) >= nodes.size()) {
+      throw std::invalid_argument("No such node");
+    }
+    auto ports = output ? nodes[static_cast<size_t>(node)]->outputs()
+                        : nodes[static_cast<size_t>(node)]->inputs();
+    if (index < 0 || static_cast<size_t>(index) >= ports.size()) {
+      throw std::invalid_argument("No such port");
+    }
+    return ports[static_cast<size_t>(index)];
+  }
+};
+
+// Holds the schedule the audio thread runs. swap() and collect() belong to
+// the message thread; process() to the audio thread, which never blocks,
+// allocates or frees. A replaced schedule is kept until the audio thread is
+// known not to be running it (a single hazard pointer), then deleted by a
+// later swap() or collect().
+class Patch {
+  std::atomic<Schedule*> current{nullptr};
+  std::atomic<Schedule*> hazard{nullptr};
+  std::vector<std::unique_ptr<Schedule>> retired;
+
+  public:
+  Patch() = default;
+  Patch(const Patch&) = delete;
+  Patch& operator=(const Patch&) = delete;
+  ~Patch() {
+    delete current.exchange(nullptr);
+    retired.clear();
+  }
+
+  void swap(std::unique_ptr<Schedule> next) {
+    Schedule* old = current.exchange(next.release());
+    if (old != nullptr) {
+      retired.emplace_back(old);
+    }
+    collect();
+  }
+
+  // delete the retired schedules the audio thread cannot be using
+  void collect() {
+    Schedule* busy = hazard.load();
+    retired.erase(std::remove_if(retired.begin(), retired.end(),
+                                 [busy](const std::unique_ptr<Schedule>& s) { return s.get() != busy; }),
+                  retired.end());
+  }
+
+  size_t pending() const { return retired.size(); }
+
+  // outputs with no schedule (or beyond the graph's outputs) are silent
+  void process(float* const* out, int outputs, int n) {
+    Schedule* s = current.load();
+    for (;;) {
+      hazard.store(s);
+      Schedule* again = current.load();
+      if (again == s) {
+        break;
+      }
+      s = again;
+    }
+    if (s != nullptr) {
+      s->process(out, outputs, n);
+    } else {
+      for (int k = 0; k < outputs; ++k) {
+        std::memset(out[k], 0, sizeof(float) * static_cast<size_t>(n));
+      }
+    }
+    hazard.store(nullptr);
+  }
+};
+
+} // namespace ky
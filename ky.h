@@ -1,9 +1,45 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cassert>
 #include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <string_view>
+#include <type_traits>
 #include <vector>
 #include <numbers>
 
+#if defined(__linux__) || defined(__APPLE__)
+#include <sys/mman.h>
+#endif
+
+#if defined(__F16C__)
+#include <immintrin.h>
+#endif
+
+#ifndef KY_PROFILE
+#define KY_PROFILE 0
+#endif
+
+#if KY_PROFILE
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <typeinfo>
+#if defined(__GNUC__)
+#include <cxxabi.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#endif
+
 namespace ky {
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -24,6 +60,9 @@ inline float lerp(float a, float b, float t) { return (1.0f - t) * a + t * b; }
 inline float mtof(float m) { return 8.175799f * powf(2.0f, m / 12.0f); }
 inline float ftom(float f) { return 12.0f * log2f(f / 8.175799f); }
 inline float dbtoa(float db) { return 1.0f * powf(10.0f, db / 20.0f); }
+// in double (or another floating type) for the units templated on one
+template <std::floating_point F>
+inline F dbtoa(F db) { return std::pow(F(10), db / F(20)); }
 inline float atodb(float a) { return 20.0f * log10f(a / 1.0f); }
 inline float sigmoid(float x) { return 2.0f / (1.0f + expf(-x)) - 1.0f; }
 // XXX softclip, etc.
@@ -66,46 +105,402 @@ static float uniform() {
   return history / 2147483647.0;
 }
 
+// the generator behind uniform() with a state of its own, for units that
+// render on different threads
+struct Noise {
+  uint32_t history = 0;
+
+  Noise() = default;
+  explicit Noise(uint32_t seed) : history(seed) {}
+
+  float operator()() {
+    history = history * 1103515245u + 12345u;
+    return static_cast<float>(static_cast<int32_t>(history) / 2147483647.0);
+  }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//// Samples //////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+// The units below are written once for a sample type T: float, double, or a
+// Pack of N floats (or doubles) that runs N independent voices in lockstep,
+// one per lane. Packs have the arithmetic operators, lane by lane, and a
+// scalar converts to a pack by filling every lane. Whatever arithmetic can't
+// be written on whole samples (branches, table reads, libm calls) loops
+// over lane(x, l) for l below lanes<T>; for a scalar that is one pass over
+// the sample itself, so it costs nothing, and for a pack the compiler
+// turns the loop into vector code where it can.
+
+template <typename T, int N>
+struct Pack {
+  T lane[N];
+
+  Pack() = default;
+  Pack(T v) {
+    for (int l = 0; l < N; ++l) lane[l] = v;
+  }
+
+  Pack& operator+=(const Pack& b) { return *this = *this + b; }
+  Pack& operator-=(const Pack& b) { return *this = *this - b; }
+  Pack& operator*=(const Pack& b) { return *this = *this * b; }
+  Pack& operator/=(const Pack& b) { return *this = *this / b; }
+
+  friend Pack operator-(Pack a) {
+    for (int l = 0; l < N; ++l) a.lane[l] = -a.lane[l];
+    return a;
+  }
+  friend Pack operator+(Pack a, const Pack& b) {
+    for (int l = 0; l < N; ++l) a.lane[l] += b.lane[l];
+    return a;
+  }
+  friend Pack operator-(Pack a, const Pack& b) {
+    for (int l = 0; l < N; ++l) a.lane[l] -= b.lane[l];
+    return a;
+  }
+  friend Pack operator*(Pack a, const Pack& b) {
+    for (int l = 0; l < N; ++l) a.lane[l] *= b.lane[l];
+    return a;
+  }
+  friend Pack operator/(Pack a, const Pack& b) {
+    for (int l = 0; l < N; ++l) a.lane[l] /= b.lane[l];
+    return a;
+  }
+};
+
+using float4 = Pack<float, 4>;
+using float8 = Pack<float, 8>;
+using double4 = Pack<double, 4>;
+
+template <typename T>
+struct SampleTraits {
+  using Scalar = T;
+  static constexpr int lanes = 1;
+  template <typename U>
+  using Of = U;  // the same shape, holding U
+};
+
+template <typename T, int N>
+struct SampleTraits<Pack<T, N>> {
+  using Scalar = T;
+  static constexpr int lanes = N;
+  template <typename U>
+  using Of = Pack<U, N>;
+};
+
+template <typename T>
+using Scalar = typename SampleTraits<T>::Scalar;
+template <typename T, typename U>
+using Lanes = typename SampleTraits<T>::template Of<U>;
+template <typename T>
+constexpr int lanes = SampleTraits<T>::lanes;
+
+template <typename T>
+  requires std::is_arithmetic_v<T>
+inline T& lane(T& v, int) { return v; }
+template <typename T>
+  requires std::is_arithmetic_v<T>
+inline T lane(const T& v, int) { return v; }
+template <typename T, int N>
+inline T& lane(Pack<T, N>& v, int l) { return v.lane[l]; }
+template <typename T, int N>
+inline T lane(const Pack<T, N>& v, int l) { return v.lane[l]; }
+
+// apply a scalar function to every lane
+template <typename T, typename F>
+inline T each(T v, F f) {
+  for (int l = 0; l < lanes<T>; ++l) lane(v, l) = f(lane(v, l));
+  return v;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 //// Support Classes //////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 
 // 1-sample delay
-class History {
-  float value = 0;
+template <typename T = float>
+class BasicHistory {
+  T value = 0;
 
   public:
-  float operator()() { return value; }
-  float operator()(float v) {
-    float tmp = value;
+  T operator()() { return value; }
+  T operator()(T v) {
+    T tmp = value;
     value = v;
     return tmp;
   }
 };
 
+using History = BasicHistory<float>;
+
 // Takes the derivative of a signal
 // the backward difference
-class Delta {
-  History history;
+template <typename T = float>
+class BasicDelta {
+  BasicHistory<T> history;
 
   public:
-  float operator()(float f) {
+  T operator()(T f) {
     return f - history(f);
   }
 };
-class ArrayFloat : public std::vector<float> {
+
+using Delta = BasicDelta<float>;
+
+// One contiguous, cache-line aligned block that per-instance DSP memory is
+// carved from. Carving bumps an offset and nothing is given back until
+// reset(), so the delay lines of an instance sit next to each other instead
+// of wherever the heap put them. Large arenas may ask for huge pages.
+class Arena {
+  char* memory = nullptr;
+  size_t capacity = 0;
+  size_t offset = 0;
+  bool mapped = false;
+
+  public:
+  static constexpr size_t alignment = 64;
+  static constexpr size_t hugePage = 2 * 1024 * 1024;
+
+  static size_t round(size_t bytes, size_t to = alignment) {
+    return (bytes + to - 1) / to * to;
+  }
+
+  Arena() = default;
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+  ~Arena() { release(); }
+
+  // make room for at least this many bytes; the current block is kept (and
+  // whatever was carved from it stays valid) when it is already big enough
+  void reserve(size_t bytes, bool hugePages = false) {
+    if (bytes <= capacity) {
+      return;
+    }
+    release();
+#if defined(__linux__) || defined(__APPLE__)
+    if (hugePages && bytes >= hugePage) {
+      size_t length = round(bytes, hugePage);
+      void* p = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (p != MAP_FAILED) {
+#if defined(MADV_HUGEPAGE)
+        madvise(p, length, MADV_HUGEPAGE);
+#endif
+        memory = static_cast<char*>(p);
+        capacity = length;
+        mapped = true;
+        return;
+      }
+    }
+#endif
+    capacity = round(bytes);
+    memory = static_cast<char*>(::operator new(capacity, std::align_val_t(alignment)));
+  }
+
+  void release() {
+    if (memory == nullptr) {
+      return;
+    }
+#if defined(__linux__) || defined(__APPLE__)
+    if (mapped) {
+      munmap(memory, capacity);
+    } else
+#endif
+    {
+      ::operator delete(memory, std::align_val_t(alignment));
+    }
+    memory = nullptr;
+    capacity = offset = 0;
+    mapped = false;
+  }
+
+  // forget every carving; the block itself is kept
+  void reset() { offset = 0; }
+
+  // nullptr when the arena is full
+  void* take(size_t bytes) {
+    bytes = round(bytes);
+    if (offset + bytes > capacity) {
+      return nullptr;
+    }
+    void* p = memory + offset;
+    offset += bytes;
+    return p;
+  }
+
+  bool owns(const void* p) const {
+    auto* c = static_cast<const char*>(p);
+    return c >= memory && c < memory + capacity;
+  }
+
+  size_t used() const { return offset; }
+  size_t size() const { return capacity; }
+};
+
+// Gives containers memory from an Arena, or from the (aligned) heap when
+// there is no arena or it is full.
+template <typename T>
+struct ArenaAllocator {
+  using value_type = T;
+  using propagate_on_container_copy_assignment = std::true_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  Arena* arena = nullptr;
+
+  ArenaAllocator() = default;
+  explicit ArenaAllocator(Arena* a) : arena(a) {}
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+  T* allocate(size_t n) {
+    if (arena != nullptr) {
+      if (void* p = arena->take(n * sizeof(T))) {
+        return static_cast<T*>(p);
+      }
+    }
+    return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Arena::alignment)));
+  }
+
+  void deallocate(T* p, size_t) {
+    if (arena != nullptr && arena->owns(p)) {
+      return;
+    }
+    ::operator delete(p, std::align_val_t(Arena::alignment));
+  }
+
+  friend bool operator==(const ArenaAllocator& a, const ArenaAllocator& b) {
+    return a.arena == b.arena;
+  }
+};
+
+// How delay memory stores a sample. float is exact; Fixed16 (Q15, clamped
+// to [-1, 1]) and Half (IEEE binary16) take half the memory and bandwidth.
+// `make golden` in test/ measures the noise floor of each against float.
+struct Fixed16 {
+  int16_t bits = 0;
+};
+struct Half {
+  uint16_t bits = 0;
+};
+
+template <typename S>
+struct Format;
+
+template <>
+struct Format<float> {
+  static float encode(float f) { return f; }
+  static float decode(float s) { return s; }
+};
+
+template <>
+struct Format<Fixed16> {
+  static Fixed16 encode(float f) {
+    f = std::fmin(std::fmax(f, -1.0f), 1.0f) * 32767.0f;
+    return {static_cast<int16_t>(f + (f < 0 ? -0.5f : 0.5f))};
+  }
+  static float decode(Fixed16 s) { return s.bits * (1.0f / 32767.0f); }
+};
+
+// branch-light conversions (after Fabian Giesen) that the compiler can
+// vectorize; rounds to nearest even. Inputs are clamped to the largest
+// half, 65504, first, so nothing becomes inf; the F16C blocks below clamp
+// the same way and store the same bits.
+template <>
+struct Format<Half> {
+  static constexpr float largest = 65504.0f;
+
+  static Half encode(float f) {
+    if (f > largest) {
+      f = largest;
+    } else if (f < -largest) {
+      f = -largest;
+    }
+    uint32_t u = std::bit_cast<uint32_t>(f);
+    uint32_t sign = u & 0x80000000u;
+    u ^= sign;
+    uint16_t h;
+    if (u > (255u << 23)) {  // NaN: quieted, the top of its payload kept
+      h = static_cast<uint16_t>(0x7e00u | ((u >> 13) & 0x3ffu));
+    } else if (u < (113u << 23)) {  // subnormal or zero
+      float magic = std::bit_cast<float>(126u << 23);
+      h = static_cast<uint16_t>(std::bit_cast<uint32_t>(std::bit_cast<float>(u) + magic) - (126u << 23));
+    } else {
+      uint32_t odd = (u >> 13) & 1u;
+      u += ((15u - 127u) << 23) + 0xfffu + odd;
+      h = static_cast<uint16_t>(u >> 13);
+    }
+    return {static_cast<uint16_t>(h | (sign >> 16))};
+  }
+  static float decode(Half s) {
+    uint32_t magnitude = static_cast<uint32_t>(s.bits & 0x7fffu) << 13;
+    float f = std::bit_cast<float>(magnitude) * 0x1p112f;
+    if ((s.bits & 0x7c00u) == 0x7c00u) {  // inf or NaN, as F16C reads them
+      f = std::bit_cast<float>(magnitude | (255u << 23));
+    }
+    return (s.bits & 0x8000u) ? -f : f;
+  }
+};
+
+// convert blocks of samples to and from a storage format
+template <typename S>
+inline void encode(const float* in, S* out, size_t n) {
+  for (size_t i = 0; i < n; ++i) out[i] = Format<S>::encode(in[i]);
+}
+template <typename S>
+inline void decode(const S* in, float* out, size_t n) {
+  for (size_t i = 0; i < n; ++i) out[i] = Format<S>::decode(in[i]);
+}
+
+#if defined(__F16C__)
+template <>
+inline void encode(const float* in, Half* out, size_t n) {
+  size_t i = 0;
+  const __m256 high = _mm256_set1_ps(Format<Half>::largest), low = _mm256_set1_ps(-Format<Half>::largest);
+  for (; i + 8 <= n; i += 8) {
+    // NaN is the second operand of each, so it passes through
+    __m256 f = _mm256_min_ps(high, _mm256_max_ps(low, _mm256_loadu_ps(in + i)));
+    __m128i h = _mm256_cvtps_ph(f, _MM_FROUND_TO_NEAREST_INT);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), h);
+  }
+  for (; i < n; ++i) out[i] = Format<Half>::encode(in[i]);
+}
+template <>
+inline void decode(const Half* in, float* out, size_t n) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+    _mm256_storeu_ps(out + i, _mm256_cvtph_ps(h));
+  }
+  for (; i < n; ++i) out[i] = Format<Half>::decode(in[i]);
+}
+#endif
+
+// An array of samples, stored as S, read back as float
+template <typename S>
+class BasicArray : public std::vector<S, ArenaAllocator<S>> {
+  using Base = std::vector<S, ArenaAllocator<S>>;
+
   public:
+  // (re)allocate n zeroed samples from the arena
+  void place(Arena& arena, size_t n) {
+    Base::operator=(Base(n, S{}, ArenaAllocator<S>(&arena)));
+  }
+
   float lookup(float samples) { 
     size_t to_the_left = static_cast<size_t>(std::floor(samples));
-    size_t to_the_right = (to_the_left == (size() - 1u)) ? 0u : to_the_left + 1u;
+    size_t to_the_right = (to_the_left == (this->size() - 1u)) ? 0u : to_the_left + 1u;
     float t = samples - (float)to_the_left;
-    return lerp(operator[](to_the_left), operator[](to_the_right), t);
+    return lerp(Format<S>::decode(Base::operator[](to_the_left)),
+                Format<S>::decode(Base::operator[](to_the_right)), t);
   }
   float phasor(float t) { 
-    return lookup(size() * t);
+    return lookup(this->size() * t);
   }
 };
 
+using ArrayFloat = BasicArray<float>;
+
 ///////////////////////////////////////////////////////////////////////////////
 //// Sines ////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
@@ -117,6 +512,20 @@ inline float sin7(float x) {
     return x * (x * (x * (x * (x * (x * (66.5723768716453f * x - 233.003319050759f) + 275.754490892928f) - 106.877929605423f) + 0.156842000875713f) - 9.85899292126983f) + 7.25653181200263f) - 8.88178419700125e-16f;
 }
 
+// one cycle of sine in 4096 points plus a guard point that repeats the first
+inline const float* sine() {
+  struct Table {
+    float data[4097] = {};
+    Table() {
+      for (int i = 0; i <= 4096; ++i) {
+        data[i] = static_cast<float>(sin((2.0 * M_PI * (i % 4096)) / 4096.0));
+      }
+    }
+  };
+  static Table table;
+  return table.data;
+}
+
 inline float sint(float t) {
   struct TableSine : ArrayFloat {
     TableSine() {
@@ -135,87 +544,125 @@ inline float sint(float t) {
 //// Oscillators //////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 
+// Phases are unsigned 32-bit fixed point: the whole range is one cycle, so
+// adding the increment wraps for free when it overflows and the phase
+// never drifts. The top bits index a table and the next ones are the
+// fraction between its points.
+
+// the fixed-point increment for a frequency
+inline uint32_t increment(double hertz, double sampleRate) {
+  double cycles = hertz / sampleRate;
+  return static_cast<uint32_t>(static_cast<int64_t>(std::llround(cycles * 4294967296.0)));
+}
+
 // functor class
-class Phasor {
-  float increment = 0; // normalized frequency
-  float value = 0;
+template <typename T = float>
+class BasicPhasor {
+  protected:
+  using Phase = Lanes<T, uint32_t>;
+  Phase step = 0; // normalized frequency
+  Phase phase = 0;
+
+  // the phase before this sample's step
+  Phase advance() {
+    Phase p = phase;
+    for (int l = 0; l < lanes<T>; ++l) {
+      lane(phase, l) += lane(step, l); // "side effect"; wraps on overflow
+    }
+    return p;
+  }
 
  public:
 
-  float operator()() {
-    float v = value; // remember value
-    value += increment; // "side effect"
-    if (value >= 1.0f) {
-      value -= 1.0f; // wrap phase
+  // the top 24 bits, which a float holds exactly, so the value is in
+  // [0, 1); a double holds all 32
+  T operator()() {
+    Phase p = advance();
+    T out;
+    for (int l = 0; l < lanes<T>; ++l) {
+      if constexpr (sizeof(Scalar<T>) >= 8) {
+        lane(out, l) = static_cast<Scalar<T>>(lane(p, l)) * (1.0 / 4294967296.0);
+      } else {
+        // through int32, which converts in vector registers; uint32 doesn't
+        lane(out, l) = static_cast<Scalar<T>>(static_cast<int32_t>(lane(p, l) >> 8)) *
+                       (1.0f / 16777216.0f);
+      }
     }
-    return v;
+    return out;
   }
 
-  void frequency(float hertz, float sampleRate) {
-    increment = hertz / sampleRate;
+  void frequency(T hertz, T sampleRate) {
+    for (int l = 0; l < lanes<T>; ++l) {
+      lane(step, l) = increment(lane(hertz, l), lane(sampleRate, l));
+    }
   }
 };
 
-// Fires at a given frequency...
+using Phasor = BasicPhasor<float>;
+
+// Fires at a given frequency, on the samples where the phase wraps
 class Timer {
-  float increment = 0;
-  float value = 0;
+  uint32_t step = 0;
+  uint32_t phase = 0;
 
   public:
   bool operator()() {
-    if (value >= 1.0f) {
-      value -= 1.0f;
-      return true;
-    }
-    value += increment;
-    return false;
+    uint32_t p = phase;
+    phase += step;
+    return phase < p;
   }
 
   void frequency(float hertz, float sampleRate) {
-    increment = hertz / sampleRate;
+    step = increment(hertz, sampleRate);
   }
 };
 
 // Quasi-Bandlimited Frequency Modulation
 
-class QuasiSaw {
+template <typename T = float>
+class BasicQuasiSaw {
+  using S = Scalar<T>;
+
   // variables and constants
-  float osc = 0;      // output of the saw oscillator
-  float phase = 0;    // phase accumulator
-  float w = 0;        // normalized frequency
-  float scaling = 0;  // scaling amount
-  float DC = 0;       // DC compensation
-  float norm = 0;              // normalization amount
-  float const a0 = 2.5f;   // precalculated coeffs
-  float const a1 = -1.5f;  // for HF compensation
-  float in_hist = 0;           // delay for the HF filter
-
-  float t = 0;
+  T osc = 0;      // output of the saw oscillator
+  T phase = 0;    // phase accumulator
+  T w = 0;        // normalized frequency
+  T scaling = 0;  // scaling amount
+  T DC = 0;       // DC compensation
+  T norm = 0;              // normalization amount
+  S const a0 = S(2.5);   // precalculated coeffs
+  S const a1 = S(-1.5);  // for HF compensation
+  T in_hist = 0;           // delay for the HF filter
+
+  T t = 0;
 
  public:
-  void frequency(float hertz, float samplerate) {
+  void frequency(T hertz, T samplerate) {
     // calculate w and scaling
     w = hertz / samplerate;  // normalized frequency
-    float n = 0.5f - w;
-    scaling = 13.0f * n * n * n * n;  // calculate scaling
-    DC = 0.376f - w * 0.752f;         // calculate DC compensation
-    norm = 1.0f - 2.0f * w;  // calculate normalization
+    T n = S(0.5) - w;
+    scaling = S(13) * n * n * n * n;  // calculate scaling
+    DC = S(0.376) - w * S(0.752);     // calculate DC compensation
+    norm = S(1) - S(2) * w;  // calculate normalization
   }
 
-  void virtualfilter(float t_) { t = t_; }
+  void virtualfilter(T t_) { t = t_; }
 
-  float operator()() {
+  T operator()() {
     // increment accumulator
-    phase += 2.0f * w;
-    if (phase >= 1.0f) {
-      phase -= 2.0f;
+    phase += S(2) * w;
+    for (int l = 0; l < lanes<T>; ++l) {
+      if (lane(phase, l) >= S(1)) {
+        lane(phase, l) -= S(2);
+      }
     }
 
     // calculate next sample
-    osc = (osc + std::sin(tau * (phase + osc * scaling * t))) * 0.5f;
+    T turn = S(2) * std::numbers::pi_v<S> * (phase + osc * scaling * t);
+    osc = (osc + each(turn, [](S x) { return std::sin(x); })) * S(0.5);
 
     // compensate HF rolloff
-    float out = a0 * osc + a1 * in_hist;
+    T out = a0 * osc + a1 * in_hist;
     in_hist = osc;
     out = out + DC;  // compensate DC offset
 
@@ -223,9 +670,167 @@ class QuasiSaw {
   }
 };
 
+using QuasiSaw = BasicQuasiSaw<float>;
+
+// sine by table: the top 12 bits of the phase pick a point, the low 20
+// are the fraction to the next
 struct Cycle : public Phasor {
+  const float* table = sine();  // kept here so the loop has no guard check
+
   float operator()() {
-    return sint(Phasor::operator()());
+    uint32_t p = advance();
+    int i = static_cast<int>(p >> 20);
+    float t = static_cast<float>(p & 0xfffff) * (1.0f / 1048576.0f);
+    return table[i] + t * (table[i + 1] - table[i]);
+  }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//// Events ///////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+// Sample-accurate events without a per-sample check. Instead of asking a
+// Timer every sample, a render loop asks how long it may run before the
+// next event, renders that much in one go, and then handles what is due:
+//
+//   for (int done = 0; done < n;) {
+//     ky::Event e;
+//     while (events.due(e)) handle(e);
+//     int m = events.until(n - done);
+//     render(out + done, m);
+//     events.advance(m);
+//     done += m;
+//   }
+//
+// Events wait in a binary heap of fixed capacity ordered by time. Times
+// are fractional samples, so a periodic event never drifts; an event fires
+// on the first sample at or after its time. Tempo-synced events are kept
+// in beats and re-timed when the tempo changes.
+
+struct Event {
+  double time = 0;    // in samples, on the scheduler's clock
+  double origin = 0;  // first firing, in samples (or beats when synced)
+  double period = 0;  // samples (or beats when synced); 0 for one-shots
+  int64_t count = 0;  // repeats so far; this one is origin + count * period
+  int id = 0;
+  bool synced = false;
+
+  double next() const { return origin + static_cast<double>(count) * period; }
+};
+
+class Scheduler {
+  std::vector<Event> heap;
+  int64_t now = 0;
+  int64_t anchor = 0;     // a sample whose beat is known exactly
+  double anchorBeat = 0;  // and that beat
+  double samplesPerBeat = 24000;
+
+  double beat() const { return anchorBeat + static_cast<double>(now - anchor) / samplesPerBeat; }
+
+  static bool later(const Event& a, const Event& b) { return a.time > b.time; }
+
+  bool push(const Event& e) {
+    if (heap.size() == heap.capacity()) {
+      return false;
+    }
+    heap.push_back(e);
+    std::push_heap(heap.begin(), heap.end(), later);
+    return true;
+  }
+
+  void retime() {
+    for (Event& e : heap) {
+      if (e.synced) e.time = static_cast<double>(now) + (e.next() - beat()) * samplesPerBeat;
+    }
+    std::make_heap(heap.begin(), heap.end(), later);
+  }
+
+  public:
+  // room for some number of pending events; call before rendering
+  void capacity(size_t events) {
+    heap.clear();
+    heap.shrink_to_fit();
+    heap.reserve(events);
+  }
+  size_t capacity() const { return heap.capacity(); }
+  size_t pending() const { return heap.size(); }
+  void clear() { heap.clear(); }
+
+  // samples since the scheduler started
+  int64_t time() const { return now; }
+
+  // once, some number of samples from now; false when full
+  bool after(double samples, int id) { return push({now + samples, now + samples, 0, 0, id, false}); }
+
+  // every period samples, first after `first` samples
+  bool every(double period, int id, double first = 0) {
+    return push({now + first, now + first, period, 0, id, false});
+  }
+
+  // every period beats, on the beat grid that started at beat 0
+  bool synced(double beats, int id) {
+    double first = std::ceil(beat() / beats) * beats;
+    return push({now + (first - beat()) * samplesPerBeat, first, beats, 0, id, true});
+  }
+
+  // change the tempo (or move the beat, e.g. to the host's play position);
+  // pending synced events keep their beats and move in time
+  void tempo(double bpm, double samplerate) {
+    anchorBeat = beat();
+    anchor = now;
+    samplesPerBeat = samplerate * 60 / bpm;
+    retime();
+  }
+  void position(double at) {
+    for (Event& e : heap) {
+      if (e.synced) {
+        e.origin = std::ceil(at / e.period) * e.period;
+        e.count = 0;
+      }
+    }
+    anchorBeat = at;
+    anchor = now;
+    retime();
+  }
+
+  // cancel every pending event with the given id
+  void remove(int id) {
+    heap.erase(std::remove_if(heap.begin(), heap.end(), [id](const Event& e) { return e.id == id; }),
+               heap.end());
+    std::make_heap(heap.begin(), heap.end(), later);
+  }
+
+  // how many samples (at most `limit`) may be rendered before an event
+  int until(int limit) const {
+    if (heap.empty()) {
+      return limit;
+    }
+    double wait = std::ceil(heap.front().time) - static_cast<double>(now);
+    return wait < limit ? std::max(0, static_cast<int>(wait)) : limit;
+  }
+
+  void advance(int samples) { now += samples; }
+
+  // take the next event due at the current sample, rescheduling it if it
+  // repeats; false when nothing is due
+  bool due(Event& event) {
+    if (heap.empty() || heap.front().time > static_cast<double>(now)) {
+      return false;
+    }
+    std::pop_heap(heap.begin(), heap.end(), later);
+    event = heap.back();
+    heap.pop_back();
+    if (event.period > 0) {
+      Event next = event;
+      ++next.count;
+      if (next.synced) {
+        next.time = static_cast<double>(now) + (next.next() - beat()) * samplesPerBeat;
+      } else {
+        next.time = next.next();
+      }
+      push(next);
+    }
+    return true;
   }
 };
 
@@ -233,73 +838,142 @@ struct Cycle : public Phasor {
 //// Delay ////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 
-class DelayLine : public ArrayFloat {
+template <typename S = float>
+class BasicDelayLine : public BasicArray<S> {
   size_t index = 0;
 
+  // the sample at or just before `samples_ago` (at most the size) before
+  // `from`, and how far past it to read. the fraction comes from
+  // samples_ago alone, not from a float index that loses bits as the
+  // buffer grows, so it is the same for every write position
+  void locate(float samples_ago, size_t from, size_t& left, float& t) const {
+    float whole = std::ceil(samples_ago);
+    t = whole - samples_ago;
+    left = (from + this->size() - static_cast<size_t>(whole)) % this->size();
+  }
+
   public:
 
+  // where the next write goes
+  size_t head() const { return index; }
+
   void write(float value) {
-    operator[](index) = value;
-    index = (index + 1) % size();
+    this->operator[](index) = Format<S>::encode(value);
+    index = (index + 1) % this->size();
   }
 
   float read(float samples_ago) {
-    float readIndex = (float)index - samples_ago;
-    if (readIndex < 0) {
-      readIndex += (float)size();
+    size_t left;
+    float t;
+    locate(samples_ago, index, left, t);
+    size_t right = left + 1 == this->size() ? 0 : left + 1;
+    return lerp(Format<S>::decode(this->operator[](left)),
+                Format<S>::decode(this->operator[](right)), t);
+  }
+
+  // block versions; read() gives exactly what n calls of read(samples_ago),
+  // each followed by a write, would give, so samples_ago must be more than
+  // n + 1 (none of the n samples read may be one of the n to be written)
+  void write(const float* in, size_t n) {
+    while (n > 0) {
+      size_t chunk = std::min(n, this->size() - index);
+      encode(in, this->data() + index, chunk);
+      in += chunk;
+      n -= chunk;
+      index = (index + chunk) % this->size();
+    }
+  }
+
+  void read(float samples_ago, float* out, size_t n) {
+    assert(samples_ago > static_cast<float>(n + 1));
+    assert(samples_ago <= static_cast<float>(this->size()));
+    size_t left;
+    float t;
+    locate(samples_ago, index, left, t);
+
+    // decode a chunk (plus the sample to its right) at a time, then lerp
+    constexpr size_t chunk = 64;
+    float decoded[chunk + 1];
+    while (n > 0) {
+      size_t m = std::min(n, chunk);
+      size_t first = std::min(m + 1, this->size() - left);
+      decode(this->data() + left, decoded, first);
+      if (first < m + 1) {
+        decode(this->data(), decoded + first, m + 1 - first);
+      }
+      for (size_t i = 0; i < m; ++i) {
+        out[i] = lerp(decoded[i], decoded[i + 1], t);
+      }
+      out += m;
+      n -= m;
+      left = (left + m) % this->size();
     }
-    return lookup(readIndex);
   }
 };
 
+using DelayLine = BasicDelayLine<float>;
+
 ///////////////////////////////////////////////////////////////////////////////
 //// Filters //////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 
 // Average this input sample with the last input sample
-class TwoSampleMean {
-  History history;
+template <typename T = float>
+class BasicTwoSampleMean {
+  BasicHistory<T> history;
 
   public:
-  float operator()(float f) {
-    return (f + history(f)) / 2.0f;
+  T operator()(T f) {
+    return (f + history(f)) / Scalar<T>(2);
   }
 };
 
+using TwoSampleMean = BasicTwoSampleMean<float>;
+
 // Another simple low-pass filter
-class OnePole {
-  float b0 = 1, a1 = 0, yn1 = 0;
+template <typename T = float>
+class BasicOnePole {
+  using S = Scalar<T>;
+  T b0 = 1, a1 = 0, yn1 = 0;
 
   public:
-  void frequency(float hertz, float samplerate) {
-    a1 = exp(-tau * hertz / samplerate);
-    b0 = 1.0f - a1;
+  void frequency(T hertz, T samplerate) {
+    T x = S(-2) * std::numbers::pi_v<S> * hertz / samplerate;
+    a1 = each(x, [](S v) { return static_cast<S>(std::exp(static_cast<double>(v))); });
+    b0 = S(1) - a1;
   }
-  float operator()(float xn) { return yn1 = b0 * xn + a1 * yn1; }
+  T operator()(T xn) { return yn1 = b0 * xn + a1 * yn1; }
 };
 
+using OnePole = BasicOnePole<float>;
+
 // Also a low-pass filter, but non-linear
-class SlewRateLimit {
-  float limit = 0;
-  float value = 0;
+template <typename T = float>
+class BasicSlewRateLimit {
+  T limit = 0;
+  T value = 0;
   public:
-  void configure(float v, float r, float samplerate) {
+  void configure(T v, T r, T samplerate) {
     value = v;
     limit = r / samplerate;
   }
-  void slewrate(float r, float samplerate) {
+  void slewrate(T r, T samplerate) {
     limit = r / samplerate;
   }
-  float operator()(float f) {
-    float v = value;
+  T operator()(T f) {
+    T v = value;
 
     // side effect....
-    float delta = f - value;
-    if (delta > limit) {
-      delta = limit;
-    }
-    else if (delta < -limit) {
-      delta = -limit;
+    T delta = f - value;
+    for (int l = 0; l < lanes<T>; ++l) {
+      auto& d = lane(delta, l);
+      auto most = lane(limit, l);
+      if (d > most) {
+        d = most;
+      }
+      else if (d < -most) {
+        d = -most;
+      }
     }
     value += delta;
 
@@ -307,33 +981,258 @@ class SlewRateLimit {
   }
 };
 
+using SlewRateLimit = BasicSlewRateLimit<float>;
+
+
+///////////////////////////////////////////////////////////////////////////////
+//// Envelopes ////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+// An ADSR envelope computed a segment at a time instead of a sample at a
+// time. The attack is a straight ramp; decay and release are exponential,
+// aimed past their end so they land on it exactly after their duration
+// (curve 0 makes them straight too). A ramp is written as start + slope * i
+// and an exponential as goal + distance * k^i, with the powers of k taken
+// eight at a time, so both loops vectorize; sustain is a constant. until()
+// tells the owner where the current segment ends, and render() returns how
+// many samples were live, so a voice knows to retire when it is less than
+// the block.
+class Envelope {
+  public:
+  enum Stage { Idle, Attack, Decay, Sustain, Release };
+
+  private:
+  static constexpr int lanes = 8;
+
+  float samplerate = 48000;
+  float attack = 0.01f, decay = 0.1f, level = 0.7f, release = 0.3f;  // seconds, level
+  float curve = 5;  // how far (in nepers) each exponential falls short of its aim
+  float peak = 1;
+
+  Stage stage = Idle;
+  float value = 0;      // the last sample written
+  int remaining = 0;    // samples left in the segment
+  float end = 0;        // value the segment lands on
+  float slope = 0;      // ramps
+  float goal = 0, distance = 0, k = 1;  // exponentials
+  float powers[lanes] = {};            // k^1 .. k^8
+  float scale = 1;                     // k^i so far
+
+  int samples(float seconds) const {
+    return std::max(0, static_cast<int>(std::lround(seconds * samplerate)));
+  }
+
+  // start a segment from the current value, or skip it when it is empty
+  void begin(Stage next) {
+    stage = next;
+    if (stage == Idle || stage == Sustain) {
+      value = stage == Idle ? 0.0f : level * peak;
+      remaining = 0;
+      return;
+    }
+    float seconds = stage == Attack ? attack : stage == Decay ? decay : release;
+    end = stage == Attack ? peak : stage == Decay ? level * peak : 0.0f;
+    remaining = samples(seconds);
+    if (remaining == 0) {
+      value = end;
+      finish();
+      return;
+    }
+    slope = (end - value) / static_cast<float>(remaining);
+    if (stage != Attack && curve > 0) {
+      // goal + (value - goal) k^remaining = end, with k^remaining = e^-curve
+      double kn = std::exp(-static_cast<double>(curve));
+      k = static_cast<float>(std::exp(-static_cast<double>(curve) / remaining));
+      goal = static_cast<float>((end - value * kn) / (1 - kn));
+      distance = value - goal;
+      double p = 1;
+      for (int j = 0; j < lanes; ++j) powers[j] = static_cast<float>(p *= k);
+      scale = 1;
+    } else {
+      k = 1;
+    }
+  }
+
+  void finish() {
+    begin(stage == Attack ? Decay : stage == Decay ? Sustain : Idle);
+  }
+
+  // m samples of the current segment into out; Multiply scales out instead
+  template <bool Multiply>
+  void segment(float* __restrict out, int m) {
+    auto put = [out](int i, float v) {
+      if constexpr (Multiply) {
+        out[i] *= v;
+      } else {
+        out[i] = v;
+      }
+    };
+    if (stage == Sustain) {
+      for (int i = 0; i < m; ++i) put(i, value);
+    } else if (k == 1) {
+      const float start = value, step = slope;
+      for (int i = 0; i < m; ++i) put(i, start + step * static_cast<float>(i + 1));
+      value = start + step * static_cast<float>(m);
+    } else {
+      int i = 0;
+      for (; i + lanes <= m; i += lanes) {
+        const float d = distance * scale;
+        for (int j = 0; j < lanes; ++j) put(i + j, goal + d * powers[j]);
+        scale *= powers[lanes - 1];
+      }
+      for (int j = 0; i < m; ++i, ++j) put(i, goal + distance * scale * powers[j]);
+      scale *= m % lanes > 0 ? powers[m % lanes - 1] : 1.0f;
+      value = goal + distance * scale;
+    }
+  }
+
+  template <bool Multiply>
+  int run(float* out, int n) {
+    int live = 0;
+    for (int done = 0; done < n;) {
+      if (stage == Idle) {
+        std::fill(out + done, out + n, 0.0f);
+        return live;
+      }
+      if (stage == Sustain) {
+        segment<Multiply>(out + done, n - done);
+        return n;
+      }
+      int m = std::min(remaining, n - done);
+      if (m < remaining) {
+        segment<Multiply>(out + done, m);
+        remaining -= m;
+      } else {
+        // the last sample lands exactly on the end
+        segment<Multiply>(out + done, m - 1);
+        if constexpr (Multiply) {
+          out[done + m - 1] *= end;
+        } else {
+          out[done + m - 1] = end;
+        }
+        value = end;
+        finish();
+      }
+      done += m;
+      live = done;
+    }
+    return live;
+  }
+
+  public:
+  void configure(float _samplerate) { samplerate = _samplerate; }
+
+  // seconds, seconds, a level relative to the peak, seconds
+  void set(float a, float d, float s, float r) {
+    attack = a;
+    decay = d;
+    level = s;
+    release = r;
+  }
+  // 0 for straight decay and release; larger bends them more
+  void shape(float nepers) { curve = nepers; }
+
+  // start (or restart, from where it is) the attack
+  void on(float velocity = 1) {
+    peak = velocity;
+    begin(Attack);
+  }
+  // release from where it is
+  void off() {
+    if (stage != Idle) begin(Release);
+  }
+
+  Stage state() const { return stage; }
+  bool idle() const { return stage == Idle; }
+
+  // samples until the current segment ends; INT_MAX while sustaining or idle
+  int until() const { return stage == Sustain || stage == Idle ? INT32_MAX : remaining; }
+
+  // write n samples of envelope; returns how many came before it went idle
+  int render(float* out, int n) { return run<false>(out, n); }
+
+  // scale n samples of a voice by the envelope; silence after it goes idle
+  int process(float* inout, int n) { return run<true>(inout, n); }
+
+  float operator()() {
+    float v;
+    render(&v, 1);
+    return v;
+  }
+};
 
 ///////////////////////////////////////////////////////////////////////////////
 //// Synths ///////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 
-class PluckedString : public DelayLine {
-  TwoSampleMean filter;
+// A Karplus-Strong waveguide string. The loop is an integer delay, a
+// first-order allpass for the fractional part of the period and the
+// two-sample mean as the loss filter (half a sample of delay), so the
+// buffer only has to hold one period: it is rounded up to a power of two
+// and indexed with a mask. Strings below the lowest frequency their buffer
+// holds are played at that frequency. In a pack, every lane is a string of
+// its own frequency and decay, sharing the buffer's write position.
+template <typename T = float>
+class BasicPluckedString : public BasicArray<T> {
+  using S = Scalar<T>;
+  using Base = BasicArray<T>;
+
+  BasicTwoSampleMean<T> filter;
+  size_t mask = 0;
+  size_t index = 0;  // where the next write goes
+
+  float samplerate = 48000;
+  T gain = 1;
+  T t60 = 1;
+  T delayTime = 1;  // in seconds
 
-  float gain = 1;
-  float t60 = 1;
-  float delayTime = 1;  // in seconds
+  Lanes<T, size_t> delay = 1;  // whole samples
+  T allpass = 0;               // coefficient
+  T x1 = 0, y1 = 0;            // allpass state
+
+  void write(T v) {
+    (*this)[index] = v;
+    index = (index + 1) & mask;
+  }
 
   public:
+  // the buffer size for strings down to `lowest` Hertz
+  static size_t samples(float lowest, float samplerate) {
+    return std::bit_ceil(static_cast<size_t>(std::ceil(samplerate / lowest)) + 2);
+  }
+
+  // (re)allocate at least n samples, rounded up to a power of two
+  void place(Arena& arena, size_t n) {
+    Base::place(arena, std::bit_ceil(n));
+    mask = this->size() - 1;
+    index = 0;
+    recalculate();
+  }
+  void resize(size_t n, T value = 0) {
+    Base::resize(std::bit_ceil(n), value);
+    mask = this->size() - 1;
+    index = 0;
+    recalculate();
+  }
 
-  void frequency(float hertz) { period(1 / hertz); }
-  void period(float seconds) {
+  void configure(float _samplerate) {
+    samplerate = _samplerate;
+    recalculate();
+  }
+
+  void frequency(T hertz) { period(S(1) / hertz); }
+  void period(T seconds) {
     delayTime = seconds;
     recalculate();
   }
 
-  void decayTime(float _t60) {
+  void decayTime(T _t60) {
     t60 = _t60;
     recalculate();
   }
 
-  void set(float frequency, float decayTime) {
-    delayTime = 1 / frequency;
+  void set(T frequency, T decayTime) {
+    delayTime = S(1) / frequency;
     t60 = decayTime;
     recalculate();
   }
@@ -341,34 +1240,1236 @@ class PluckedString : public DelayLine {
   // given t60 and frequency (seconds and Hertz), calculate the gain...
   //
   // for a given frequency, our algorithm applies *gain* frequency-many
-  // times per second. given a t60 time we can calculate how many times (n)
-  // gain will be applied in those t60 seconds. we want to reduce the signal
-  // by 60dB over t60 seconds or over n-many applications. this means that
-  // we want gain to be a number that, when multiplied by itself n times,
-  // becomes 60 dB quieter than it began.
+  // times per second, so over t60 seconds it is applied t60 / delayTime
+  // times. we want those applications together to make the signal 60 dB
+  // quieter.
+  //
+  // the loop delay in samples is split into the mean's half sample, a whole
+  // number of samples and an allpass delay kept in [0.1, 1.1), where its
+  // phase delay is flattest. the coefficient gives that delay exactly at the
+  // fundamental, not just near DC, so high strings stay in tune
+  //
+  // the allpass state (x1, y1) is kept across a retune: it holds the signal
+  // already in the loop, and zeroing it mid-note would click. a pluck, which
+  // replaces what is in the loop, clears it instead.
   //
   void recalculate() {
-    int n = t60 / delayTime;
-    gain = pow(dbtoa(-60), 1.0f / n);
-    //printf("t:%f\tf:%f\tn:%d\tg:%f\n", t60, 1 / delayTime, n, gain);
-    //fflush(stdout);
+    for (int l = 0; l < lanes<T>; ++l) {
+      lane(gain, l) = std::pow(dbtoa(S(-60)), lane(delayTime, l) / lane(t60, l));
+      double loop = static_cast<double>(samplerate) * lane(delayTime, l) - 0.5;
+      double whole = std::max(1.0, std::floor(loop - 0.1));
+      if (this->size() > 1) {
+        whole = std::min(whole, static_cast<double>(this->size() - 1));
+      }
+      double fraction = std::clamp(loop - whole, 0.1, 1.1);
+      lane(delay, l) = static_cast<size_t>(whole);
+      double w = 2 * std::numbers::pi / (loop + 0.5);  // the fundamental
+      lane(allpass, l) = static_cast<S>(std::sin(w * (1 - fraction) / 2) /
+                                        std::sin(w * (1 + fraction) / 2));
+    }
   }
 
-  float operator()() {
-    float v = filter(read(48000 * delayTime)) * gain;
+  T operator()() {
+    T x;
+    for (int l = 0; l < lanes<T>; ++l) {
+      lane(x, l) = lane((*this)[(index - lane(delay, l)) & mask], l);
+    }
+    T y = allpass * (x - y1) + x1;
+    x1 = x;
+    y1 = y;
+    T v = filter(y) * gain;
     write(v);
     return v;
   }
 
-  void pluck(float gain = 1) {
-    // put noise in the last N sample memory positions. N depends on
-    // frequency
-    //
-    int n = int(ceil(delayTime * 48000));
-    for (int i = 0; i < n; ++i) {
-      write(uniform() * gain);
+  // put noise in the period's worth of sample memory that is read next, in
+  // every lane or (of a pack) just one; the write position stays where it
+  // is, so the other lanes play on undisturbed
+  void pluck(S gain = 1, int voice = -1) {
+    excite([] { return uniform(); }, gain, voice);
+  }
+
+  // the same, drawing from the caller's noise instead of the shared uniform()
+  void pluck(Noise& noise, S gain = 1, int voice = -1) {
+    excite([&] { return noise(); }, gain, voice);
+  }
+
+  private:
+  template <typename Source>
+  void excite(Source&& source, S gain, int voice) {
+    for (int l = 0; l < lanes<T>; ++l) {
+      if (voice >= 0 && voice != l) {
+        continue;
+      }
+      size_t n = std::min<size_t>(lane(delay, l) + 1, this->size());
+      for (size_t i = 0; i < n; ++i) {
+        lane((*this)[(index - n + i) & mask], l) = source() * gain;
+      }
+      lane(x1, l) = 0;
+      lane(y1, l) = 0;
     }
   }
 };
 
+using PluckedString = BasicPluckedString<float>;
+
+///////////////////////////////////////////////////////////////////////////////
+//// Dispatch /////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+// The loops that vectorize well (grains, modes, sinc) are compiled once per
+// instruction set and chosen at run time, so one binary uses AVX2 or
+// AVX-512 on hosts that have them. Each kernel's body is written once and
+// always inlined into a thin wrapper per target. Multiplies and adds are
+// never fused, so every variant rounds the same way and gives the same bits.
+// The choice is made from CPUID on first use; KY_ISA=sse2|avx2|avx512 in
+// the environment, or dispatch(), asks for a particular one (or the best
+// below it that the host can run).
+
+enum class Isa { Baseline, AVX2, AVX512 };
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define KY_DISPATCH 1
+#define KY_INLINE __attribute__((always_inline)) inline
+// AVX-512 brings FMA along, and -march may give it to every variant; keep
+// the compiler from fusing in any of them (clang inside each kernel body,
+// GCC on each variant the body is inlined into)
+#if defined(__clang__)
+#define KY_EXACT _Pragma("clang fp contract(off)")
+#define KY_UNFUSED
+#else
+#define KY_EXACT
+#define KY_UNFUSED __attribute__((optimize("fp-contract=off")))
+#endif
+#define KY_AVX512 __attribute__((target("avx2,avx512f,avx512vl,avx512bw,avx512dq")))
+#else
+#define KY_DISPATCH 0
+#define KY_INLINE inline
+#define KY_EXACT
+#endif
+
+inline const char* name(Isa isa) {
+  switch (isa) {
+    case Isa::AVX512: return "avx512";
+    case Isa::AVX2: return "avx2";
+    default: return KY_DISPATCH ? "sse2" : "generic";
+  }
+}
+
+// the best the host can run
+inline Isa supported() {
+#if KY_DISPATCH
+  bool avx2 = __builtin_cpu_supports("avx2");
+  // everything KY_AVX512 targets; AVX-512F alone (Knights Landing) is not enough
+  if (avx2 && __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vl") &&
+      __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512dq")) {
+    return Isa::AVX512;
+  }
+  if (avx2) return Isa::AVX2;
+#endif
+  return Isa::Baseline;
+}
+
+struct Kernels {
+  Isa isa;
+  // add one grain to out[first, last); see Granular
+  void (*grain)(const float* data, int length, const float* window, float p, float r,
+                float ph, float inc, float a, float* out, int first, int last);
+  // run a group of 8 modes over n samples, adding each mode's output to
+  // its lane of partial; x may be null; see Modal
+  void (*modes)(float* re, float* im, const float* cr, const float* ci, const float* gain,
+                const float* x, float* partial, int n);
+  // one output of a polyphase filter: taps (a multiple of 8) of x against
+  // the phase between coefficient rows a and b; see Resampler
+  float (*sinc)(const float* x, const float* a, const float* b, float f, int taps);
+};
+
+// the variant for an instruction set (or the best below it)
+inline const Kernels& kernels(Isa isa);
+
+// ask for an instruction set; returns the one actually used
+inline Isa dispatch(Isa isa);
+
+// the kernels in use
+inline const Kernels& kernels();
+
+///////////////////////////////////////////////////////////////////////////////
+//// Granular /////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+// a Hann window over [0, 1]; 1024 points plus two (silent) guard points
+inline const float* hann() {
+  struct Table {
+    float data[1026] = {};
+    Table() {
+      for (int i = 0; i < 1024; ++i) {
+        data[i] = static_cast<float>(0.5 - 0.5 * cos(2.0 * M_PI * i / 1024.0));
+      }
+    }
+  };
+  static Table table;
+  return table.data;
+}
+
+// one grain across a block, written without branches or float compares
+// so it becomes SIMD with gathers where the target has them
+KY_INLINE void grain(const float* __restrict data, int length, const float* __restrict window,
+                     float p, float r, float ph, float inc, float a, float* __restrict out,
+                     int first, int last) {
+  KY_EXACT
+  for (int i = first; i < last; ++i) {
+    float w = (ph + i * inc) * 1024.0f;
+    int wi = static_cast<int>(w);
+    float env = window[wi] + (w - wi) * (window[wi + 1] - window[wi]);
+
+    float x = p + i * r;
+    int si = static_cast<int>(x);
+    float t = x - si;
+    si -= length & -(si >= length);
+    int sj = (si + 1) & -(si + 1 != length);
+    float sample = data[si] + t * (data[sj] - data[si]);
+
+    out[i] += a * env * sample;
+  }
+}
+
+// Many short, windowed, overlapping reads of a live DelayLine or a loaded
+// buffer. The grains live in a fixed pool (struct of arrays, live grains
+// packed at the front) that capacity() allocates up front; spawning appends
+// and retiring swaps the last grain into the gap, both O(1). Each block,
+// the grains due in it are spawned up front, pre-rolled so each starts on
+// its exact sample, and then each grain is rendered across the whole block
+// in one branch-free loop (in a few pieces, for a grain fast enough to read
+// a whole buffer's length in one block). Grains only read forwards: a rate
+// below zero, from speed() or its jitter, is held at zero.
+class Granular {
+  std::vector<float> cursor, rate, phase, increment, amplitude;
+  size_t active = 0;
+
+  float samplerate = 48000;
+  float perSecond = 10;
+  float interval = 4800;  // samples between grains, from the two above
+  float untilNext = 0;
+  float length = 0.05f;   // grain duration in seconds
+  float where = 0;        // samples ago (live) or fraction (buffer)
+  float whereJitter = 0;
+  float pitch = 1;
+  float pitchJitter = 0;
+  float level = 1;
+
+  // start(offset) is where a grain starting offset samples into the block reads from
+  template <typename F>
+  void schedule(size_t size, int n, F&& start) {
+    while (untilNext < n) {
+      float at = start(untilNext) + whereJitter * uniform();
+      float r = pitch * (1 + pitchJitter * uniform());
+      spawn(at, r, length, level, untilNext, size);
+      untilNext += interval;
+    }
+    untilNext -= n;
+  }
+
+  void run(const float* data, size_t size, float* out, int n) {
+    const float* window = hann();
+    const Kernels& kernel = kernels();
+    const float end = static_cast<float>(size);
+    for (size_t g = 0; g < active; ++g) {
+      const float p = cursor[g], r = rate[g], ph = phase[g], inc = increment[g], a = amplitude[g];
+
+      // only the samples where the window is open: a grain spawned in
+      // this block starts late, a finishing one stops early
+      int first = ph < 0 ? static_cast<int>(std::ceil(-ph / inc)) : 0;
+      int last = static_cast<int>(std::ceil((1.0f - ph) / inc));
+      first = std::min(first, n);
+      last = std::clamp(last, first, n);
+
+      // the kernel reads p + i * r, which must stay below twice the size;
+      // a piece that would not is rebased into [0, size) first
+      int piece = r > 0 ? std::max(1, static_cast<int>((end - 1) / r)) : n;
+      for (int from = first; from < last; from += piece) {
+        int to = std::min(last, from + piece);
+        float base = p;
+        if (p + to * r >= 2 * end - 1) {
+          base = std::fmod(p + from * r, end) - from * r;
+        }
+        kernel.grain(data, static_cast<int>(size), window, base, r, ph, inc, a, out, from, to);
+      }
+
+      cursor[g] = std::fmod(p + n * r, end);
+      phase[g] = ph + n * inc;
+    }
+
+    for (size_t i = 0; i < active;) {
+      if (phase[i] >= 1.0f) {
+        retire(i);
+      } else {
+        ++i;
+      }
+    }
+  }
+
+  void retire(size_t i) {
+    --active;
+    cursor[i] = cursor[active];
+    rate[i] = rate[active];
+    phase[i] = phase[active];
+    increment[i] = increment[active];
+    amplitude[i] = amplitude[active];
+  }
+
+  public:
+  // allocate the pool; call before rendering (e.g. in prepareToPlay)
+  void capacity(size_t grains) {
+    for (auto* v : {&cursor, &rate, &phase, &increment, &amplitude}) {
+      v->assign(grains, 0.0f);
+    }
+    active = 0;
+  }
+  size_t capacity() const { return cursor.size(); }
+  size_t grains() const { return active; }
+
+  void configure(float _samplerate) {
+    samplerate = _samplerate;
+    interval = samplerate / perSecond;
+  }
+  void density(float grainsPerSecond) {
+    perSecond = grainsPerSecond;
+    interval = samplerate / perSecond;
+  }
+  void duration(float seconds) { length = seconds; }
+  // samples ago for a DelayLine, a fraction of the length for a buffer;
+  // the jitter is in samples
+  void position(float value, float jitter = 0) {
+    where = value;
+    whereJitter = jitter;
+  }
+  void speed(float ratio, float jitter = 0) {
+    pitch = ratio;
+    pitchJitter = jitter;
+  }
+  void gain(float amplitude) { level = amplitude; }
+
+  // start a grain at sample `start` of a source of the given size, `offset`
+  // samples into the next rendered block; false when the pool is full
+  bool spawn(float start, float ratio, float seconds, float gain, float offset, size_t size) {
+    if (active == cursor.size()) {
+      return false;
+    }
+    size_t i = active++;
+    increment[i] = 1.0f / (seconds * samplerate);
+    phase[i] = -offset * increment[i];
+    rate[i] = std::max(ratio, 0.0f);  // forwards only; see above
+    amplitude[i] = gain;
+    float s = std::fmod(start - offset * rate[i], static_cast<float>(size));
+    cursor[i] = s < 0 ? s + static_cast<float>(size) : s;
+    return true;
+  }
+
+  // add n samples of grains read from a loaded buffer to out
+  void render(const ArrayFloat& buffer, float* out, int n) {
+    const float size = static_cast<float>(buffer.size());
+    schedule(buffer.size(), n, [&](float) { return where * size; });
+    run(buffer.data(), buffer.size(), out, n);
+  }
+
+  // add n samples of grains read from a live delay line, after this block's
+  // input has been written to it; grains start `position` samples behind
+  // the write head as it was at their first sample
+  void render(const DelayLine& line, float* out, int n) {
+    float head = static_cast<float>(line.head());
+    schedule(line.size(), n, [&](float offset) { return head - n + offset - where; });
+    run(line.data(), line.size(), out, n);
+  }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//// Modal ////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+// a group of modes over a block, its state in registers throughout; the
+// loop over the lanes becomes SIMD
+template <bool Driven>
+KY_INLINE void modes(float* __restrict re, float* __restrict im, const float* __restrict cr,
+                     const float* __restrict ci, const float* __restrict gain,
+                     const float* __restrict x, float* __restrict partial, int n) {
+  KY_EXACT
+  constexpr int lanes = 8;
+  float a[lanes], b[lanes], c[lanes], s[lanes], g[lanes];
+  for (int j = 0; j < lanes; ++j) {
+    a[j] = re[j];
+    b[j] = im[j];
+    c[j] = cr[j];
+    s[j] = ci[j];
+    g[j] = gain[j];
+  }
+  for (int i = 0; i < n; ++i) {
+    for (int j = 0; j < lanes; ++j) {
+      float u = c[j] * a[j] - s[j] * b[j];
+      if constexpr (Driven) u += g[j] * x[i];
+      b[j] = s[j] * a[j] + c[j] * b[j];
+      a[j] = u;
+      partial[i * lanes + j] += b[j];
+    }
+  }
+  for (int j = 0; j < lanes; ++j) {
+    re[j] = a[j];
+    im[j] = b[j];
+  }
+}
+
+KY_INLINE void modes(float* re, float* im, const float* cr, const float* ci, const float* gain,
+                     const float* x, float* partial, int n) {
+  if (x != nullptr) {
+    modes<true>(re, im, cr, ci, gain, x, partial, n);
+  } else {
+    modes<false>(re, im, cr, ci, gain, x, partial, n);
+  }
+}
+
+// A bank of damped sinusoids, each a complex number turned by a fixed
+// rotation every sample: z = c z + g x, with c = r e^(iw). Output is the sum
+// of the imaginary parts, so an impulse into a mode of gain g rings as
+// g r^n sin(w n). That is one complex multiply per mode per sample, with no
+// table and no phase to wrap.
+//
+// Modes are stored as a struct of arrays and run in groups of `lanes`; a
+// group keeps its state in registers across the block while the inner loop
+// over its lanes becomes SIMD. Every `interval` samples the bank corrects
+// each mode's magnitude to the one its exact (double) decay predicts, so
+// rounding in the float rotation never makes a mode grow or die early, and
+// groups whose modes have all fallen below `threshold` stop being run until
+// the bank is excited again.
+class Modal {
+  public:
+  static constexpr int lanes = 8;
+  static constexpr int interval = 256;
+  static constexpr float threshold = 1e-10f;  // squared magnitude, -100 dB
+
+  private:
+  std::vector<float> re, im, cr, ci, input, level;
+  std::vector<double> decay;   // expected change of level over an interval
+  std::vector<uint32_t> live;  // groups being run
+  std::vector<float> sum;      // per-lane partial sums, interval x lanes
+  size_t count = 0;
+  float samplerate = 48000;
+  int untilRenormalize = interval;
+  bool excited = false;
+
+  size_t groups() const { return re.size() / lanes; }
+
+  // every group with an audible input gain runs again
+  void wake() {
+    live.clear();
+    for (size_t group = 0; group < groups(); ++group) {
+      for (int j = 0; j < lanes; ++j) {
+        if (input[group * lanes + j] != 0 || level[group * lanes + j] >= threshold) {
+          live.push_back(static_cast<uint32_t>(group));
+          break;
+        }
+      }
+    }
+    excited = true;
+  }
+
+  // pin each mode's magnitude to its predicted level; after an excitation
+  // the measured level becomes the new prediction
+  void renormalize() {
+    size_t kept = 0;
+    for (uint32_t group : live) {
+      bool audible = false;
+      for (size_t k = group * lanes; k < (group + 1) * lanes; ++k) {
+        float m = re[k] * re[k] + im[k] * im[k];
+        if (!excited) {
+          float expected = static_cast<float>(level[k] * decay[k]);
+          float g = m > 0 ? std::sqrt(expected / m) : 0.0f;
+          re[k] *= g;
+          im[k] *= g;
+          m = expected;
+        }
+        level[k] = m;
+        if (m < threshold) {
+          re[k] = im[k] = level[k] = 0;
+        } else {
+          audible = true;
+        }
+      }
+      if (audible) live[kept++] = group;
+    }
+    live.resize(kept);
+    excited = false;
+  }
+
+  void block(const float* x, float* out, int n) {
+    std::fill(sum.begin(), sum.begin() + n * lanes, 0.0f);
+    const Kernels& kernel = kernels();
+    for (uint32_t group : live) {
+      size_t k = group * lanes;
+      kernel.modes(&re[k], &im[k], &cr[k], &ci[k], &input[k], x, sum.data(), n);
+    }
+    for (int i = 0; i < n; ++i) {
+      float y = 0;
+      for (int j = 0; j < lanes; ++j) y += sum[i * lanes + j];
+      out[i] += y;
+    }
+  }
+
+  public:
+  // allocate room for some number of modes, all silent; call before
+  // rendering (e.g. in prepareToPlay)
+  void capacity(size_t modes) {
+    size_t padded = (modes + lanes - 1) / lanes * lanes;
+    for (auto* v : {&re, &im, &cr, &ci, &input, &level}) v->assign(padded, 0.0f);
+    decay.assign(padded, 1.0);
+    live.clear();
+    live.reserve(padded / lanes);
+    sum.assign(interval * lanes, 0.0f);
+    count = modes;
+    untilRenormalize = interval;
+    excited = false;
+  }
+  size_t capacity() const { return count; }
+  // modes currently being run, in whole groups
+  size_t running() const { return live.size() * lanes; }
+
+  void configure(float _samplerate) { samplerate = _samplerate; }
+
+  // set mode i to ring at the given frequency, falling 60 dB in t60
+  // seconds (0 rings forever), scaled by gain; modes at or above Nyquist
+  // are silent
+  void mode(size_t i, float hertz, float t60, float gain = 1) {
+    double w = 2.0 * M_PI * hertz / samplerate;
+    double r = t60 > 0 ? std::pow(10.0, -3.0 / (t60 * samplerate)) : 1.0;
+    cr[i] = static_cast<float>(r * std::cos(w));
+    ci[i] = static_cast<float>(r * std::sin(w));
+    input[i] = hertz > 0 && hertz < samplerate / 2 ? gain : 0.0f;
+    decay[i] = std::pow(r, 2.0 * interval);
+  }
+
+  // silence every mode, keeping their settings
+  void clear() {
+    std::fill(re.begin(), re.end(), 0.0f);
+    std::fill(im.begin(), im.end(), 0.0f);
+    std::fill(level.begin(), level.end(), 0.0f);
+    live.clear();
+  }
+
+  // an impulse of the given strength into every mode, just before the next
+  // sample, so that sample is already g r sin(w)
+  void strike(float velocity = 1) {
+    for (size_t k = 0; k < re.size(); ++k) re[k] += input[k] * velocity;
+    wake();
+  }
+
+  // add n samples of the ringing modes to out; with an excitation, each
+  // mode is also driven by it (a PluckedString into a body, say)
+  void render(const float* excitation, float* out, int n) {
+    for (int done = 0; done < n;) {
+      int m = std::min(n - done, untilRenormalize);
+      const float* x = excitation != nullptr ? excitation + done : nullptr;
+      if (x != nullptr && std::any_of(x, x + m, [](float v) { return v != 0; })) {
+        wake();
+        block(x, out + done, m);
+      } else {
+        block(nullptr, out + done, m);
+      }
+      done += m;
+      untilRenormalize -= m;
+      if (untilRenormalize == 0) {
+        renormalize();
+        untilRenormalize = interval;
+      }
+    }
+  }
+  void render(float* out, int n) { render(nullptr, out, n); }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//// Resampling ///////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+// one polyphase output: the coefficients are interpolated between two
+// adjacent phases, and the dot product runs in eight lanes summed at the
+// end, so it vectorizes without reassociating anything
+KY_INLINE float sinc(const float* __restrict x, const float* __restrict a,
+                     const float* __restrict b, float f, int taps) {
+  KY_EXACT
+  constexpr int lanes = 8;
+  float sum[lanes] = {};
+  for (int k = 0; k < taps; k += lanes) {
+    for (int j = 0; j < lanes; ++j) {
+      float c = a[k + j] + f * (b[k + j] - a[k + j]);
+      sum[j] += x[k + j] * c;
+    }
+  }
+  float y = 0;
+  for (int j = 0; j < lanes; ++j) y += sum[j];
+  return y;
+}
+
+// Band-limited resampling by any ratio, with a Kaiser-windowed sinc held
+// as a table of phases (linearly interpolated between them). The ratio is
+// input samples per output sample: 2 plays an octave up, 44100 / 48000
+// converts 44.1 kHz to 48 kHz. The filter's cutoff is set for the largest
+// ratio it will see, so it also keeps an octave-up sample from aliasing.
+//
+// read() pulls from a whole buffer (sample playback), with a ratio per
+// block or per sample. process() streams: push whatever input there is,
+// take what output that makes; needed(n) says how much input makes n
+// outputs, so an engine can run at its own fixed rate whatever the host's.
+class Resampler {
+  public:
+  enum Quality { Fast, Good, Best };
+
+  private:
+  static constexpr int phases = 256;
+
+  std::vector<float> table;  // (phases + 1) rows of taps
+  int taps = 16;
+  std::vector<float> scratch;  // one filter's worth, for the edges
+
+  // streaming: a ring of `capacity` samples written twice over, so the
+  // `fill` samples from `start` on always read as one contiguous run
+  std::vector<float> ring;
+  size_t capacity = 0;
+  size_t start = 0;
+  size_t fill = 0;
+  double time = 0;  // position of the next output, from start
+  double step = 1;
+
+  const float* window() const { return ring.data() + start; }
+
+  int half() const { return taps / 2 - 1; }  // taps before the center
+
+  // the output at `position` of x, with x[i] readable for every tap
+  float at(const float* x, double position) const {
+    double whole = std::floor(position);
+    double scaled = (position - whole) * phases;
+    int p = static_cast<int>(scaled);
+    const float* a = &table[static_cast<size_t>(p) * static_cast<size_t>(taps)];
+    return kernels().sinc(x + static_cast<ptrdiff_t>(whole) - half(), a, a + taps,
+                          static_cast<float>(scaled - p), taps);
+  }
+
+  // the same near the ends of a buffer, reading silence outside it
+  float edge(const float* x, size_t length, double position) {
+    float* padded = scratch.data();
+    ptrdiff_t first = static_cast<ptrdiff_t>(std::floor(position)) - half();
+    for (int k = 0; k < taps; ++k) {
+      ptrdiff_t i = first + k;
+      padded[k] = i >= 0 && static_cast<size_t>(i) < length ? x[i] : 0.0f;
+    }
+    return at(padded + half(), position - std::floor(position));
+  }
+
+  float sample(const float* x, size_t length, double position) {
+    double first = std::floor(position) - half();
+    if (first >= 0 && first + taps <= static_cast<double>(length)) {
+      return at(x, position);
+    }
+    return edge(x, length, position);
+  }
+
+  public:
+  Resampler() { configure(Good); }
+
+  // build the filter for a quality (8, 16 or 32 taps per output sample) and
+  // the largest ratio it will be asked for; not for the audio thread
+  void configure(Quality quality, double largestRatio = 1, size_t maximumBlock = 4096) {
+    static const int tapsFor[] = {8, 16, 32};
+    static const double betaFor[] = {5, 7, 9};
+    static const double passFor[] = {0.80, 0.90, 0.95};
+    // the filter gets longer as its cutoff comes down, so the transition
+    // band stays as narrow at the output rate
+    taps = tapsFor[quality] * static_cast<int>(std::ceil(std::max(1.0, largestRatio)));
+    double beta = betaFor[quality];
+    double cutoff = passFor[quality] * 0.5 / std::max(1.0, largestRatio);  // cycles per input sample
+
+    auto bessel = [](double x) {  // I0, the zeroth-order modified Bessel function
+      double sum = 1, term = 1;
+      for (int k = 1; k < 32; ++k) {
+        term *= (x / (2 * k)) * (x / (2 * k));
+        sum += term;
+      }
+      return sum;
+    };
+
+    table.assign(static_cast<size_t>(phases + 1) * static_cast<size_t>(taps), 0.0f);
+    for (int p = 0; p <= phases; ++p) {
+      double fraction = static_cast<double>(p) / phases, total = 0;
+      std::vector<double> row(static_cast<size_t>(taps));
+      for (int k = 0; k < taps; ++k) {
+        double t = k - half() - fraction;  // distance from the output, in input samples
+        double r = t / (taps / 2.0);
+        double window = std::fabs(r) < 1 ? bessel(beta * std::sqrt(1 - r * r)) / bessel(beta) : 0.0;
+        double x = 2 * M_PI * cutoff * t;
+        double h = 2 * cutoff * (x == 0 ? 1.0 : std::sin(x) / x) * window;
+        row[static_cast<size_t>(k)] = h;
+        total += h;
+      }
+      for (int k = 0; k < taps; ++k) {
+        table[static_cast<size_t>(p * taps + k)] = static_cast<float>(row[static_cast<size_t>(k)] / total);
+      }
+    }
+
+    scratch.assign(static_cast<size_t>(taps), 0.0f);
+    // what the longest block at the largest ratio reads, plus the filter
+    capacity = static_cast<size_t>(taps) +
+               maximumBlock * static_cast<size_t>(std::ceil(std::max(1.0, largestRatio))) + 1;
+    ring.assign(2 * capacity, 0.0f);
+    reset();
+  }
+
+  int order() const { return taps; }
+  // input samples between going in and coming out of process()
+  int latency() const { return taps / 2; }
+
+  // read n samples of a buffer from `position` on, `ratio` samples apart;
+  // returns the position after them
+  double read(const float* source, size_t length, double position, double ratio,
+              float* out, int n) {
+    for (int i = 0; i < n; ++i) {
+      out[i] = sample(source, length, position);
+      position += ratio;
+    }
+    return position;
+  }
+
+  // the same with a ratio per output sample (a glide or vibrato)
+  double read(const float* source, size_t length, double position, const float* ratios,
+              float* out, int n) {
+    for (int i = 0; i < n; ++i) {
+      out[i] = sample(source, length, position);
+      position += ratios[i];
+    }
+    return position;
+  }
+
+  // streaming
+  void ratio(double inputPerOutput) { step = inputPerOutput; }
+  void reset() {
+    std::fill(ring.begin(), ring.end(), 0.0f);
+    start = 0;
+    fill = static_cast<size_t>(half());
+    time = half();
+  }
+
+  // input samples process() needs to make n more outputs
+  int needed(int n) const {
+    double last = std::floor(time + (n - 1) * step);
+    return std::max(0, static_cast<int>(last) + taps / 2 + 1 - static_cast<int>(fill));
+  }
+
+  // push `count` input samples and write up to `room` outputs; returns how
+  // many were written. what is pushed and not yet read must fit the block
+  // size and ratio given to configure()
+  int process(const float* in, int count, float* out, int room) {
+    assert(fill + static_cast<size_t>(count) <= capacity);
+    for (int i = 0; i < count; ++i) {
+      size_t w = (start + fill++) % capacity;
+      ring[w] = ring[w + capacity] = in[i];
+    }
+    int produced = 0;
+    while (produced < room && std::floor(time) + taps / 2 < static_cast<double>(fill)) {
+      out[produced++] = at(window(), time);
+      time += step;
+    }
+    // let go of what later outputs no longer read
+    size_t used = static_cast<size_t>(std::max(0.0, std::floor(time) - half()));
+    used = std::min(used, fill);
+    start = (start + used) % capacity;
+    fill -= used;
+    time -= static_cast<double>(used);
+    return produced;
+  }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//// Kernel variants //////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+// one wrapper per target around each kernel body
+#if KY_DISPATCH
+#define KY_VARIANTS(type, kernel, parameters, arguments)                           \
+  KY_UNFUSED inline type kernel##Baseline parameters { return kernel arguments; }  \
+  KY_UNFUSED __attribute__((target("avx2"))) inline type kernel##AVX2 parameters { \
+    return kernel arguments;                                                       \
+  }                                                                                \
+  KY_UNFUSED KY_AVX512 inline type kernel##AVX512 parameters {                     \
+    return kernel arguments;                                                       \
+  }
+#else
+#define KY_VARIANTS(type, kernel, parameters, arguments) \
+  inline type kernel##Baseline parameters { return kernel arguments; }
+#endif
+
+KY_VARIANTS(void, grain,
+            (const float* data, int length, const float* window, float p, float r, float ph,
+             float inc, float a, float* out, int first, int last),
+            (data, length, window, p, r, ph, inc, a, out, first, last))
+KY_VARIANTS(void, modes,
+            (float* re, float* im, const float* cr, const float* ci, const float* gain,
+             const float* x, float* partial, int n),
+            (re, im, cr, ci, gain, x, partial, n))
+KY_VARIANTS(float, sinc, (const float* x, const float* a, const float* b, float f, int taps),
+            (x, a, b, f, taps))
+
+#undef KY_VARIANTS
+
+inline const Kernels& kernels(Isa isa) {
+  static const Kernels table[] = {
+      {Isa::Baseline, grainBaseline, modesBaseline, sincBaseline},
+#if KY_DISPATCH
+      {Isa::AVX2, grainAVX2, modesAVX2, sincAVX2},
+      {Isa::AVX512, grainAVX512, modesAVX512, sincAVX512},
+#endif
+  };
+  return table[static_cast<int>(std::min(isa, supported()))];
+}
+
+inline std::atomic<const Kernels*>& selected() {
+  static std::atomic<const Kernels*> kernel{[] {
+    const char* asked = std::getenv("KY_ISA");
+    std::string_view isa = asked != nullptr ? asked : "";
+    if (isa == "sse2" || isa == "generic") return &kernels(Isa::Baseline);
+    if (isa == "avx2") return &kernels(Isa::AVX2);
+    return &kernels(Isa::AVX512);
+  }()};
+  return kernel;
+}
+
+inline Isa dispatch(Isa isa) {
+  selected().store(&kernels(isa));
+  return kernels().isa;
+}
+
+inline const Kernels& kernels() { return *selected().load(std::memory_order_relaxed); }
+
+///////////////////////////////////////////////////////////////////////////////
+//// Composition //////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+// Compose units into one block loop:
+//
+//   ky::process(ky::stage(q) * 0.5f >> ky::stage(lowpass), out, n);
+//
+// >> feeds the left side into the right, * and + combine two branches fed
+// the same input, and a float is a constant. Sources (units with a
+// float operator()()) ignore their input. Before the loop, small units are
+// copied into locals, so their state and coefficients live in registers
+// instead of being reloaded through `this` on every sample; they are
+// copied back afterwards. Units that own memory (delay lines) are used in
+// place, and so is every unit of an expression that stages one unit more
+// than once (two copies would each run on their own and one would be lost
+// on the way back). The whole expression inlines into a single loop.
+
+struct Expression {};
+
+template <typename E>
+concept Composable = std::derived_from<E, Expression>;
+
+template <typename U>
+constexpr bool hoistable =
+    std::is_trivially_copyable_v<U> && std::is_copy_assignable_v<U>;
+
+template <typename U>
+inline float apply(U& unit, float x) {
+  if constexpr (std::is_invocable_r_v<float, U&, float>) {
+    return unit(x);
+  } else {
+    return unit();
+  }
+}
+
+template <typename U>
+struct Stage : Expression {
+  U& unit;
+  static constexpr int stages = 1;
+
+  struct Local {
+    U& home;
+    U local;
+    float operator()(float x) { return apply(local, x); }
+    void commit() { home = local; }
+  };
+  struct InPlace {
+    U& home;
+    float operator()(float x) { return apply(home, x); }
+    void commit() {}
+  };
+
+  template <bool hoist = true>
+  auto kernel() const {
+    if constexpr (hoist && hoistable<U>) {
+      return Local{unit, unit};
+    } else {
+      return InPlace{unit};
+    }
+  }
+  void units(const void** list) const { *list = &unit; }
+};
+
+struct Constant : Expression {
+  float value;
+  static constexpr int stages = 0;
+
+  struct Kernel {
+    float value;
+    float operator()(float) const { return value; }
+    void commit() {}
+  };
+  template <bool hoist = true>
+  Kernel kernel() const { return {value}; }
+  void units(const void**) const {}
+};
+
+struct Then {
+  template <typename A, typename B>
+  static float apply(A& a, B& b, float x) { return b(a(x)); }
+};
+struct Times {
+  template <typename A, typename B>
+  static float apply(A& a, B& b, float x) {
+    float left = a(x);
+    return left * b(x);
+  }
+};
+struct Plus {
+  template <typename A, typename B>
+  static float apply(A& a, B& b, float x) {
+    float left = a(x);
+    return left + b(x);
+  }
+};
+
+template <typename Op, typename A, typename B>
+struct Binary : Expression {
+  A a;
+  B b;
+  static constexpr int stages = A::stages + B::stages;
+
+  template <typename KA, typename KB>
+  struct Kernel {
+    KA a;
+    KB b;
+    float operator()(float x) { return Op::apply(a, b, x); }
+    void commit() {
+      a.commit();
+      b.commit();
+    }
+  };
+
+  template <bool hoist = true>
+  auto kernel() const {
+    using KA = decltype(a.template kernel<hoist>());
+    using KB = decltype(b.template kernel<hoist>());
+    return Kernel<KA, KB>{a.template kernel<hoist>(), b.template kernel<hoist>()};
+  }
+  void units(const void** list) const {
+    a.units(list);
+    b.units(list + A::stages);
+  }
+};
+
+// wrap a unit (by reference) so it can be composed
+template <typename U>
+inline Stage<U> stage(U& unit) { return {{}, unit}; }
+
+template <Composable A, Composable B>
+inline Binary<Then, A, B> operator>>(A a, B b) { return {{}, a, b}; }
+template <Composable A, Composable B>
+inline Binary<Times, A, B> operator*(A a, B b) { return {{}, a, b}; }
+template <Composable A, Composable B>
+inline Binary<Plus, A, B> operator+(A a, B b) { return {{}, a, b}; }
+
+template <Composable A>
+inline auto operator*(A a, float f) { return a * Constant{{}, f}; }
+template <Composable A>
+inline auto operator*(float f, A a) { return Constant{{}, f} * a; }
+template <Composable A>
+inline auto operator+(A a, float f) { return a + Constant{{}, f}; }
+template <Composable A>
+inline auto operator+(float f, A a) { return Constant{{}, f} + a; }
+
+// whether some unit is staged more than once
+template <Composable E>
+inline bool aliased(const E& expression) {
+  const void* units[E::stages > 0 ? E::stages : 1];
+  expression.units(units);
+  for (int i = 1; i < E::stages; ++i) {
+    for (int j = 0; j < i; ++j) {
+      if (units[i] == units[j]) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// the block loops, over the kernel built from a whole expression
+template <typename K>
+inline void drive(K kernel, const float* in, float* out, int n) {
+  for (int i = 0; i < n; ++i) {
+    out[i] = kernel(in[i]);
+  }
+  kernel.commit();
+}
+
+template <typename K>
+inline void drive(K kernel, float* __restrict out, int n) {
+  for (int i = 0; i < n; ++i) {
+    out[i] = kernel(0.0f);
+  }
+  kernel.commit();
+}
+
+// run an expression over a block; out may be the same as in
+template <Composable E>
+inline void process(const E& expression, const float* in, float* out, int n) {
+  if (aliased(expression)) {
+    drive(expression.template kernel<false>(), in, out, n);
+  } else {
+    drive(expression.kernel(), in, out, n);
+  }
+}
+
+// run an expression that starts with a source; out must not overlap memory
+// the units read (a table or delay line), which lets table lookups vectorize
+template <Composable E>
+inline void process(const E& expression, float* __restrict out, int n) {
+  if (aliased(expression)) {
+    drive(expression.template kernel<false>(), out, n);
+  } else {
+    drive(expression.kernel(), out, n);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//// Probes ///////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+// Where the time goes, per unit. Build with KY_PROFILE=1 and wrap the calls
+// to measure, either a whole block call
+//
+//   { KY_PROBE("DelayLine::read", n); line.read(ago, out, n); }
+//
+// or a unit, by declaring it as ky::Probed<ky::QuasiSaw> q; (every call is
+// timed and counted as one sample, which costs a cycle counter read, so
+// probing blocks is cheaper). Each thread counts into its own slot, written
+// only by that thread, so probes never lock or contend; report() sums the
+// slots by name. A thread gives its slot back when it exits, counts and
+// all, so the next thread carries on from them; what arrives while every
+// slot is held is counted as dropped. Cycles are TSC ticks on x86 and
+// nanoseconds elsewhere.
+// Without KY_PROFILE, KY_PROBE is nothing, Probed<U> is U and report() is
+// empty.
+
+struct ProbeReport {
+  const char* name;
+  uint64_t calls, samples, cycles;
+};
+
+class Profile {
+  public:
+  static constexpr bool enabled = KY_PROFILE;
+  static constexpr int probes = 64;   // distinct names
+  static constexpr int threads = 64;  // live at once; more are dropped
+  static constexpr const char* droppedName = "(dropped)";
+
+#if KY_PROFILE
+  private:
+  struct Slot {
+    std::atomic<bool> taken{false};
+    std::atomic<uint64_t> calls[probes], samples[probes], cycles[probes];
+  };
+
+  static Slot* slots() {
+    static Slot table[threads];
+    return table;
+  }
+
+  // calls and samples that found no slot (or no probe id)
+  static std::atomic<uint64_t>* dropped() {
+    static std::atomic<uint64_t> counts[2];
+    return counts;
+  }
+
+  // holds a slot for the life of its thread
+  struct Claim {
+    Slot* slot = nullptr;
+    Claim() {
+      for (int i = 0; i < threads && slot == nullptr; ++i) {
+        bool free = false;
+        if (slots()[i].taken.compare_exchange_strong(free, true, std::memory_order_acquire)) {
+          slot = &slots()[i];
+        }
+      }
+    }
+    ~Claim() {
+      if (slot != nullptr) {
+        slot->taken.store(false, std::memory_order_release);
+      }
+    }
+  };
+  static std::atomic<const char*>* names() {
+    static std::atomic<const char*> table[probes];
+    return table;
+  }
+  static std::atomic<int>& registered() {
+    static std::atomic<int> count{0};
+    return count;
+  }
+  static Slot* mine() {
+    thread_local Claim claim;
+    return claim.slot;
+  }
+  static void bump(std::atomic<uint64_t>& counter, uint64_t by) {
+    counter.store(counter.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+  }
+
+  public:
+  static uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::steady_clock::now().time_since_epoch())
+                                     .count());
+#endif
+  }
+
+  // the probe for a name (kept, not copied); -1 when there are too many
+  static int id(const char* name) {
+    int i = registered().fetch_add(1);
+    if (i >= probes) {
+      return -1;
+    }
+    names()[i].store(name);
+    return i;
+  }
+
+  // a readable name for a unit type, kept for good
+  template <typename U>
+  static const char* name() {
+    static const std::string readable = [] {
+      const char* mangled = typeid(U).name();
+#if defined(__GNUC__)
+      int status = 0;
+      char* plain = abi::__cxa_demangle(mangled, nullptr, nullptr, &status);
+      if (plain != nullptr) {
+        std::string s(plain);
+        std::free(plain);
+        return s;
+      }
+#endif
+      return std::string(mangled);
+    }();
+    return readable.c_str();
+  }
+
+  static void add(int id, uint64_t samples, uint64_t cycles) {
+    Slot* slot = mine();
+    if (slot == nullptr || id < 0) {
+      dropped()[0].fetch_add(1, std::memory_order_relaxed);
+      dropped()[1].fetch_add(samples, std::memory_order_relaxed);
+      return;
+    }
+    bump(slot->calls[id], 1);
+    bump(slot->samples[id], samples);
+    bump(slot->cycles[id], cycles);
+  }
+
+  // totals over every thread, one entry per name, busiest first; safe to
+  // call while the probes run (totals may be a moment behind). Anything
+  // dropped comes last, as an entry named droppedName with no cycles.
+  static std::vector<ProbeReport> report() {
+    std::vector<ProbeReport> entries;
+    int count = std::min(registered().load(), probes);
+    for (int p = 0; p < count; ++p) {
+      const char* name = names()[p].load();
+      if (name == nullptr) {
+        continue;
+      }
+      ProbeReport total{name, 0, 0, 0};
+      for (int t = 0; t < threads; ++t) {
+        total.calls += slots()[t].calls[p].load(std::memory_order_relaxed);
+        total.samples += slots()[t].samples[p].load(std::memory_order_relaxed);
+        total.cycles += slots()[t].cycles[p].load(std::memory_order_relaxed);
+      }
+      auto same = std::find_if(entries.begin(), entries.end(),
+                               [&](const ProbeReport& e) { return std::strcmp(e.name, name) == 0; });
+      if (same == entries.end()) {
+        entries.push_back(total);
+      } else {
+        same->calls += total.calls;
+        same->samples += total.samples;
+        same->cycles += total.cycles;
+      }
+    }
+    std::sort(entries.begin(), entries.end(),
+              [](const ProbeReport& a, const ProbeReport& b) { return a.cycles > b.cycles; });
+    uint64_t calls = dropped()[0].load(std::memory_order_relaxed);
+    if (calls > 0) {
+      entries.push_back({droppedName, calls, dropped()[1].load(std::memory_order_relaxed), 0});
+    }
+    return entries;
+  }
+
+  // zero every count; only exact while no probe is running
+  static void reset() {
+    for (int t = 0; t < threads; ++t) {
+      for (int p = 0; p < probes; ++p) {
+        slots()[t].calls[p].store(0, std::memory_order_relaxed);
+        slots()[t].samples[p].store(0, std::memory_order_relaxed);
+        slots()[t].cycles[p].store(0, std::memory_order_relaxed);
+      }
+    }
+    dropped()[0].store(0, std::memory_order_relaxed);
+    dropped()[1].store(0, std::memory_order_relaxed);
+  }
+#else
+  static std::vector<ProbeReport> report() { return {}; }
+  static void reset() {}
+#endif
+};
+
+#if KY_PROFILE
+// times its scope
+class ProbeScope {
+  int id;
+  uint64_t samples;
+  uint64_t start;
+
+  public:
+  ProbeScope(int probe, uint64_t n) : id(probe), samples(n), start(Profile::now()) {}
+  ~ProbeScope() { Profile::add(id, samples, Profile::now() - start); }
+  ProbeScope(const ProbeScope&) = delete;
+  ProbeScope& operator=(const ProbeScope&) = delete;
+};
+
+#define KY_PROBE_JOIN2(a, b) a##b
+#define KY_PROBE_JOIN(a, b) KY_PROBE_JOIN2(a, b)
+#define KY_PROBE(name, samples)                                                 \
+  static const int KY_PROBE_JOIN(kyProbe, __LINE__) = ::ky::Profile::id(name);  \
+  ::ky::ProbeScope KY_PROBE_JOIN(kyScope, __LINE__)(KY_PROBE_JOIN(kyProbe, __LINE__), (samples))
+
+template <typename U>
+struct Probed : U {
+  using U::U;
+
+  template <typename... A>
+  auto operator()(A&&... a) -> decltype(std::declval<U&>()(std::forward<A>(a)...)) {
+    static const int probe = Profile::id(Profile::name<U>());
+    ProbeScope scope(probe, 1);
+    return U::operator()(std::forward<A>(a)...);
+  }
+};
+#else
+#define KY_PROBE(name, samples) ((void)0)
+
+template <typename U>
+struct Probed : U {
+  using U::U;
+};
+#endif
+
 } // namespace ky
@@ -0,0 +1,193 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace ky {
+
+///////////////////////////////////////////////////////////////////////////////
+//// Worker Pool //////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+// tell the core we are spinning
+inline void relax() {
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+  _mm_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield");
+#endif
+}
+
+// Renders voice partitions on pinned worker threads. The caller (the audio
+// thread) renders partition 0 itself while the workers render partitions
+// 1..n-1 into their private buffers; the partitions are then summed in
+// index order, so the output does not depend on which thread finishes first.
+//
+// start() and stop() allocate, spawn and join; call them from prepareToPlay
+// and releaseResources. render() only touches atomics and, when a worker
+// has gone to sleep, the futex behind std::atomic::notify_all.
+//
+class RenderPool {
+ public:
+  // render partition p (of n) into out, which is zeroed and frames long
+  using Job = void (*)(void* context, int p, int n, float* out, int frames);
+
+  RenderPool() = default;
+  RenderPool(const RenderPool&) = delete;
+  RenderPool& operator=(const RenderPool&) = delete;
+  ~RenderPool() { stop(); }
+
+  void start(int workerCount, int maxFrames) {
+    stop();
+    capacity = std::max(maxFrames, 0);
+    lane.resize(static_cast<size_t>(std::max(workerCount, 0)) + 1);
+    for (auto& l : lane) {
+      l.buffer.assign(static_cast<size_t>(capacity), 0.0f);
+    }
+    running.store(true, std::memory_order_relaxed);
+    // read here, not in the workers: a render() or stop() may bump the
+    // generation before a worker first runs, and it must not miss that
+    unsigned seen = generation.load(std::memory_order_acquire);
+    for (size_t i = 1; i < lane.size(); ++i) {
+      lane[i].thread = std::thread([this, i, seen] { work(static_cast<int>(i), seen); });
+      configure(lane[i].thread, static_cast<int>(i));
+    }
+  }
+
+  void stop() {
+    if (lane.size() > 1) {
+      running.store(false, std::memory_order_relaxed);
+      generation.fetch_add(1, std::memory_order_release);
+      generation.notify_all();
+      for (size_t i = 1; i < lane.size(); ++i) {
+        if (lane[i].thread.joinable()) {
+          lane[i].thread.join();
+        }
+      }
+    }
+    lane.clear();
+  }
+
+  // below this many frames the wakeup costs more than it saves
+  void threshold(int frames) { minimum = frames; }
+
+  // how long a worker busy-waits for the next block before sleeping
+  void spin(int iterations) { spins = iterations; }
+
+  int partitions() const { return static_cast<int>(std::max<size_t>(lane.size(), 1)); }
+
+  // render all partitions of job and write their sum to out
+  void render(Job job, void* context, float* out, int frames) {
+    int n = partitions();
+    if (n == 1 || frames < minimum || frames > capacity) {
+      std::memset(out, 0, sizeof(float) * static_cast<size_t>(frames));
+      job(context, 0, 1, out, frames);
+      return;
+    }
+
+    task = job;
+    argument = context;
+    length = frames;
+    remaining.store(n - 1, std::memory_order_relaxed);
+    generation.fetch_add(1, std::memory_order_release);
+    generation.notify_all();
+
+    float* mine = lane[0].buffer.data();
+    std::memset(mine, 0, sizeof(float) * static_cast<size_t>(frames));
+    job(context, 0, n, mine, frames);
+
+    while (remaining.load(std::memory_order_acquire) != 0) {
+      relax();
+    }
+
+    std::memcpy(out, mine, sizeof(float) * static_cast<size_t>(frames));
+    for (int p = 1; p < n; ++p) {
+      const float* in = lane[static_cast<size_t>(p)].buffer.data();
+      for (int i = 0; i < frames; ++i) {
+        out[i] += in[i];
+      }
+    }
+  }
+
+ private:
+  struct alignas(64) Lane {
+    std::vector<float> buffer;
+    std::thread thread;
+  };
+
+  void work(int p, unsigned seen) {
+    for (;;) {
+      unsigned now = seen;
+      for (int i = 0; i < spins; ++i) {
+        now = generation.load(std::memory_order_acquire);
+        if (now != seen) {
+          break;
+        }
+        relax();
+      }
+      while (now == seen) {
+        generation.wait(seen, std::memory_order_acquire);
+        now = generation.load(std::memory_order_acquire);
+      }
+      seen = now;
+
+      if (!running.load(std::memory_order_relaxed)) {
+        return;
+      }
+
+      int n = static_cast<int>(lane.size());
+      float* out = lane[static_cast<size_t>(p)].buffer.data();
+      std::memset(out, 0, sizeof(float) * static_cast<size_t>(length));
+      task(argument, p, n, out, length);
+      remaining.fetch_sub(1, std::memory_order_acq_rel);
+    }
+  }
+
+  // pin worker p to its own core and ask for real-time priority; both are
+  // best effort, since hosts and sandboxes may refuse
+  static void configure(std::thread& thread, int p) {
+#if defined(__linux__)
+    unsigned cores = std::thread::hardware_concurrency();
+    if (cores > 1) {
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      CPU_SET(static_cast<int>(static_cast<unsigned>(p) % cores), &set);
+      pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+    }
+    sched_param param{};
+    param.sched_priority = sched_get_priority_max(SCHED_FIFO) - 1;
+    pthread_setschedparam(thread.native_handle(), SCHED_FIFO, &param);
+#else
+    (void)thread;
+    (void)p;
+#endif
+  }
+
+  std::vector<Lane> lane;
+  int capacity = 0;
+  int minimum = 64;
+  int spins = 4096;
+
+  // written by the caller before the generation bump; read after it
+  Job task = nullptr;
+  void* argument = nullptr;
+  int length = 0;
+
+  alignas(64) std::atomic<unsigned> generation{0};
+  alignas(64) std::atomic<int> remaining{0};
+  std::atomic<bool> running{false};
+};
+
+} // namespace ky
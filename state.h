@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace ky {
+
+///////////////////////////////////////////////////////////////////////////////
+//// State ////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+// A compact binary container for plugin state:
+//
+//   "KYST"  u32 version
+//   then chunks, each:  tag (4 chars)  u32 part  u64 size  payload
+//
+// Numbers are little-endian and every chunk starts on an 8-byte boundary,
+// so a reader can hand out payloads in place instead of copying them. Large
+// payloads are written as several parts of the same tag, numbered from 0,
+// so they can be consumed one part at a time.
+
+constexpr char stateMagic[4] = {'K', 'Y', 'S', 'T'};
+constexpr uint32_t stateVersion = 1;
+
+inline void put(unsigned char* p, uint64_t v, int bytes) {
+  for (int i = 0; i < bytes; ++i) p[i] = static_cast<unsigned char>(v >> (8 * i));
+}
+inline uint64_t get(const unsigned char* p, int bytes) {
+  uint64_t v = 0;
+  for (int i = 0; i < bytes; ++i) v |= static_cast<uint64_t>(p[i]) << (8 * i);
+  return v;
+}
+
+// Sink is anything with append(const void*, size_t), e.g. juce::MemoryBlock
+template <typename Sink>
+class StateWriter {
+  Sink& sink;
+  uint64_t written = 0;
+
+  void append(const void* data, size_t size) {
+    sink.append(data, size);
+    written += size;
+  }
+
+  public:
+  explicit StateWriter(Sink& s) : sink(s) {
+    unsigned char header[8];
+    std::memcpy(header, stateMagic, 4);
+    put(header + 4, stateVersion, 4);
+    append(header, sizeof(header));
+  }
+
+  // write a payload, split into parts of at most `part` bytes
+  void chunk(std::string_view tag, const void* data, uint64_t size, uint64_t part = 1 << 20) {
+    auto* bytes = static_cast<const unsigned char*>(data);
+    uint32_t index = 0;
+    do {
+      uint64_t n = size < part ? size : part;
+      unsigned char header[16] = {};
+      std::memcpy(header, tag.data(), tag.size() < 4 ? tag.size() : 4);
+      put(header + 4, index++, 4);
+      put(header + 8, n, 8);
+      append(header, sizeof(header));
+      if (n > 0) append(bytes, static_cast<size_t>(n));
+      static const unsigned char zeros[8] = {};
+      if (n % 8 != 0) append(zeros, static_cast<size_t>(8 - n % 8));
+      bytes += n;
+      size -= n;
+    } while (size > 0);
+  }
+};
+
+struct StateChunk {
+  char tag[4];
+  uint32_t part;
+  const unsigned char* data;  // points into the reader's input
+  uint64_t size;
+
+  bool is(std::string_view t) const { return t.size() == 4 && std::memcmp(tag, t.data(), 4) == 0; }
+};
+
+// Reads chunks in place; a truncated or foreign buffer reads as invalid or
+// simply ends early, it never reads out of bounds.
+class StateReader {
+  const unsigned char* begin;
+  const unsigned char* end;
+  const unsigned char* at;
+
+  public:
+  StateReader(const void* data, size_t size)
+      : begin(static_cast<const unsigned char*>(data)), end(begin + size), at(begin + 8) {}
+
+  bool valid() const {
+    return end - begin >= 8 && std::memcmp(begin, stateMagic, 4) == 0 && version() <= stateVersion;
+  }
+  uint32_t version() const { return static_cast<uint32_t>(get(begin + 4, 4)); }
+
+  bool next(StateChunk& chunk) {
+    if (!valid() || end - at < 16) return false;
+    std::memcpy(chunk.tag, at, 4);
+    chunk.part = static_cast<uint32_t>(get(at + 4, 4));
+    chunk.size = get(at + 8, 8);
+    if (chunk.size > static_cast<uint64_t>(end - at - 16)) return false;
+    chunk.data = at + 16;
+    uint64_t padded = (chunk.size + 7) / 8 * 8;
+    at += 16 + (padded < static_cast<uint64_t>(end - at - 16) ? padded : static_cast<uint64_t>(end - at - 16));
+    return true;
+  }
+};
+
+} // namespace ky
@@ -0,0 +1,395 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ky {
+
+///////////////////////////////////////////////////////////////////////////////
+//// Streaming ////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+// A WAV file (PCM 16/24/32 or float 32) that is decoded on demand rather
+// than loaded. On POSIX systems the file is memory-mapped read-only, so every
+// voice and every plugin instance playing it shares the same pages of the
+// OS page cache; elsewhere it is read through stdio. Only the I/O thread
+// decodes from the file itself; the audio thread reads the preloaded head
+// and the voices' ring buffers.
+class WavFile {
+  std::string name;
+  const unsigned char* mapped = nullptr;
+  size_t mappedSize = 0;
+  FILE* file = nullptr;
+  std::mutex fileLock;  // stdio fallback only; taken by the I/O thread
+
+  size_t dataOffset = 0;
+  size_t frameCount = 0;
+  int channelCount = 0;
+  int bits = 0;
+  bool floating = false;
+  float sampleRate = 0;
+
+  std::vector<float> head;  // the first frames, decoded at load
+  size_t headFrames = 0;
+
+  static uint32_t u32(const unsigned char* p) { return p[0] | p[1] << 8 | p[2] << 16 | uint32_t(p[3]) << 24; }
+  static uint16_t u16(const unsigned char* p) { return static_cast<uint16_t>(p[0] | p[1] << 8); }
+
+  // stdio positions past 2 GiB; long, which fseek and ftell take, is 32
+  // bits on Windows
+  static bool seek(FILE* f, uint64_t at, int whence = SEEK_SET) {
+#if defined(_WIN32)
+    return _fseeki64(f, static_cast<__int64>(at), whence) == 0;
+#else
+    return std::fseek(f, static_cast<long>(at), whence) == 0;
+#endif
+  }
+  static uint64_t tell(FILE* f) {
+#if defined(_WIN32)
+    return static_cast<uint64_t>(_ftelli64(f));
+#else
+    return static_cast<uint64_t>(std::ftell(f));
+#endif
+  }
+
+  // p holds the first size bytes of a file of total bytes
+  bool parse(const unsigned char* p, size_t size, uint64_t total) {
+    if (size < 12 || std::memcmp(p, "RIFF", 4) != 0 || std::memcmp(p + 8, "WAVE", 4) != 0) {
+      return false;
+    }
+    size_t at = 12;
+    bool format = false;
+    while (at + 8 <= size) {
+      const unsigned char* chunk = p + at;
+      size_t length = u32(chunk + 4);
+      if (std::memcmp(chunk, "fmt ", 4) == 0 && length >= 16 && at + 8 + 16 <= size) {
+        uint16_t tag = u16(chunk + 8);
+        if (tag == 0xfffe && length >= 40 && at + 8 + 26 <= size) {
+          tag = u16(chunk + 8 + 24);  // WAVE_FORMAT_EXTENSIBLE sub-format
+        }
+        channelCount = u16(chunk + 10);
+        sampleRate = static_cast<float>(u32(chunk + 12));
+        bits = u16(chunk + 22);
+        floating = tag == 3;
+        format = (tag == 1 && (bits == 16 || bits == 24 || bits == 32)) || (floating && bits == 32);
+      } else if (std::memcmp(chunk, "data", 4) == 0) {
+        if (!format || channelCount == 0) {
+          return false;
+        }
+        dataOffset = at + 8;
+        uint64_t available = total > dataOffset ? total - dataOffset : 0;
+        frameCount = static_cast<size_t>(std::min<uint64_t>(length, available) /
+                                         (static_cast<size_t>(channelCount) * bits / 8));
+        return true;
+      }
+      at += 8 + length + (length & 1);
+    }
+    return false;
+  }
+
+  void convert(const unsigned char* p, size_t samples, float* out) const {
+    switch (bits) {
+      case 16:
+        for (size_t i = 0; i < samples; ++i, p += 2)
+          out[i] = static_cast<int16_t>(u16(p)) * (1.0f / 32768.0f);
+        break;
+      case 24:
+        for (size_t i = 0; i < samples; ++i, p += 3)
+          out[i] = static_cast<int32_t>(uint32_t(p[0]) << 8 | uint32_t(p[1]) << 16 | uint32_t(p[2]) << 24) * (1.0f / 2147483648.0f);
+        break;
+      default:
+        for (size_t i = 0; i < samples; ++i, p += 4) {
+          uint32_t u = u32(p);
+          out[i] = floating ? std::bit_cast<float>(u) : static_cast<int32_t>(u) * (1.0f / 2147483648.0f);
+        }
+        break;
+    }
+  }
+
+  public:
+  WavFile() = default;
+  WavFile(const WavFile&) = delete;
+  WavFile& operator=(const WavFile&) = delete;
+  ~WavFile() { close(); }
+
+  // open a file and decode its first preload frames; false if it is not a
+  // WAV file we can play
+  bool open(const std::string& path, size_t preload = 65536) {
+    close();
+    name = path;
+#if defined(__linux__) || defined(__APPLE__)
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+      ::close(fd);
+      return false;
+    }
+    void* p = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) return false;
+    mapped = static_cast<const unsigned char*>(p);
+    mappedSize = static_cast<size_t>(info.st_size);
+    if (!parse(mapped, mappedSize, mappedSize)) {
+      close();
+      return false;
+    }
+#else
+    file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr) return false;
+    seek(file, 0, SEEK_END);
+    uint64_t total = tell(file);
+    seek(file, 0);
+    std::vector<unsigned char> header(1 << 16);
+    size_t got = std::fread(header.data(), 1, header.size(), file);
+    if (!parse(header.data(), got, total)) {
+      close();
+      return false;
+    }
+#endif
+    headFrames = std::min(preload, frameCount);
+    head.resize(headFrames * static_cast<size_t>(channelCount));
+    decode(0, headFrames, head.data());
+    return true;
+  }
+
+  void close() {
+#if defined(__linux__) || defined(__APPLE__)
+    if (mapped != nullptr) munmap(const_cast<unsigned char*>(mapped), mappedSize);
+#endif
+    if (file != nullptr) std::fclose(file);
+    mapped = nullptr;
+    file = nullptr;
+    mappedSize = frameCount = headFrames = 0;
+    head.clear();
+  }
+
+  // decode interleaved frames [frame, frame + count) into out; may touch
+  // the disk, so never call it on the audio thread
+  void decode(size_t frame, size_t count, float* out) {
+    count = std::min(count, frameCount - std::min(frame, frameCount));
+    size_t stride = static_cast<size_t>(channelCount) * bits / 8;
+    if (mapped != nullptr) {
+      convert(mapped + dataOffset + frame * stride, count * static_cast<size_t>(channelCount), out);
+      return;
+    }
+    std::lock_guard<std::mutex> lock(fileLock);
+    unsigned char scratch[8192];
+    size_t per = sizeof(scratch) / stride;
+    while (count > 0) {
+      size_t n = std::min(count, per);
+      if (!seek(file, static_cast<uint64_t>(dataOffset) + static_cast<uint64_t>(frame) * stride)) break;
+      n = std::fread(scratch, stride, n, file);
+      if (n == 0) break;
+      convert(scratch, n * static_cast<size_t>(channelCount), out);
+      out += n * static_cast<size_t>(channelCount);
+      frame += n;
+      count -= n;
+    }
+  }
+
+  // ask the OS to start reading frames we will need soon
+  void prefetch(size_t frame, size_t count) const {
+#if defined(__linux__) || defined(__APPLE__)
+    if (mapped == nullptr || frame >= frameCount) return;
+    size_t stride = static_cast<size_t>(channelCount) * bits / 8;
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t begin = (dataOffset + frame * stride) / page * page;
+    size_t end = std::min(mappedSize, dataOffset + (frame + count) * stride);
+    if (end > begin) madvise(const_cast<unsigned char*>(mapped) + begin, end - begin, MADV_WILLNEED);
+#else
+    (void)frame;
+    (void)count;
+#endif
+  }
+
+  const std::string& path() const { return name; }
+  size_t frames() const { return frameCount; }
+  int channels() const { return channelCount; }
+  float rate() const { return sampleRate; }
+  size_t preloaded() const { return headFrames; }
+  const float* preload() const { return head.data(); }
+};
+
+// Opens each file once per process; voices that play the same file share
+// one mapping and one preloaded head. Message thread only.
+class SampleCache {
+  std::mutex lock;
+  std::map<std::string, std::weak_ptr<WavFile>> files;
+
+  public:
+  std::shared_ptr<WavFile> open(const std::string& path, size_t preload = 65536) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (auto file = files[path].lock()) return file;
+    auto file = std::make_shared<WavFile>();
+    if (!file->open(path, preload)) return nullptr;
+    files[path] = file;
+    return file;
+  }
+
+  static SampleCache& shared() {
+    static SampleCache cache;
+    return cache;
+  }
+};
+
+// One playback of a WavFile. start() and render() belong to the audio
+// thread; fill() to the I/O thread. Frames come from the file's preloaded
+// head, then from a single-producer, single-consumer ring that the I/O
+// thread keeps ahead of the play position. A frame that has not arrived in
+// time plays as silence and is counted as an underrun.
+class StreamVoice {
+  std::shared_ptr<WavFile> file;
+  std::vector<float> ring;  // interleaved frames
+  size_t mask = 0;          // ring capacity in frames, minus one
+  int channels = 0;
+
+  // frame numbers are positions in the file
+  std::atomic<size_t> readFrame{0};   // audio: next frame to play
+  std::atomic<size_t> writeFrame{0};  // I/O: frames before this are in the ring
+  std::atomic<unsigned> generation{0};  // bumped by start()
+  std::atomic<unsigned> filled{0};      // the generation the ring holds
+  unsigned seen = 0;                    // I/O thread's copy of generation
+  std::atomic<bool> playing{false};
+  size_t position = 0;
+  std::atomic<size_t> underruns{0};
+
+  public:
+  // ringFrames is rounded up to a power of two
+  StreamVoice(std::shared_ptr<WavFile> f, size_t ringFrames = 32768) : file(std::move(f)) {
+    size_t n = 1;
+    while (n < ringFrames) n <<= 1;
+    mask = n - 1;
+    channels = file->channels();
+    ring.assign(n * static_cast<size_t>(channels), 0.0f);
+  }
+
+  // play from the top; the first frames come from the preloaded head, so
+  // there is nothing to wait for
+  void start() {
+    position = 0;
+    readFrame.store(file->preloaded(), std::memory_order_relaxed);
+    generation.fetch_add(1, std::memory_order_release);
+    playing.store(true, std::memory_order_release);
+  }
+  void stop() { playing.store(false, std::memory_order_release); }
+  bool active() const { return playing.load(std::memory_order_acquire); }
+  size_t missed() const { return underruns.load(std::memory_order_relaxed); }
+
+  // add n frames to out; a mono file plays on every output channel
+  void render(float* const* out, int outputs, int n) {
+    if (!active()) return;
+    const size_t head = file->preloaded(), frames = file->frames();
+    const float* preload = file->preload();
+    const bool ready = filled.load(std::memory_order_acquire) == generation.load(std::memory_order_relaxed);
+    const size_t available = ready ? writeFrame.load(std::memory_order_acquire) : head;
+
+    for (int i = 0; i < n; ++i, ++position) {
+      if (position >= frames) {
+        stop();
+        break;
+      }
+      const float* frame;
+      if (position < head) {
+        frame = preload + position * static_cast<size_t>(channels);
+      } else if (position < available) {
+        frame = ring.data() + (position & mask) * static_cast<size_t>(channels);
+      } else {
+        underruns.fetch_add(1, std::memory_order_relaxed);
+        continue;
+      }
+      for (int c = 0; c < outputs; ++c) out[c][i] += frame[c % channels];
+    }
+    if (position > head) readFrame.store(position, std::memory_order_release);
+  }
+
+  // top the ring up; returns true if there was anything to do
+  bool fill(size_t chunk = 4096) {
+    unsigned g = generation.load(std::memory_order_acquire);
+    size_t write = writeFrame.load(std::memory_order_relaxed);
+    if (g != seen) {
+      seen = g;
+      write = file->preloaded();
+      writeFrame.store(write, std::memory_order_relaxed);
+      filled.store(g, std::memory_order_release);
+    }
+    if (!active()) return false;
+
+    const size_t capacity = mask + 1;
+    size_t read = readFrame.load(std::memory_order_acquire);
+    size_t end = std::min(read + capacity, file->frames());
+    if (write >= end) return false;
+
+    size_t n = std::min(chunk, end - write);
+    size_t slot = write & mask;
+    size_t first = std::min(n, capacity - slot);
+    file->decode(write, first, ring.data() + slot * static_cast<size_t>(channels));
+    if (first < n) file->decode(write + first, n - first, ring.data());
+    file->prefetch(write + n, chunk * 4);
+    writeFrame.store(write + n, std::memory_order_release);
+    return true;
+  }
+};
+
+// The background I/O thread that keeps every registered voice's ring full.
+// add() and remove() are for the message thread.
+class Streamer {
+  std::mutex lock;
+  std::vector<StreamVoice*> voices;
+  std::atomic<bool> running{false};
+  std::thread thread;
+
+  public:
+  Streamer() = default;
+  Streamer(const Streamer&) = delete;
+  Streamer& operator=(const Streamer&) = delete;
+  ~Streamer() { stop(); }
+
+  void start() {
+    if (running.exchange(true)) return;
+    thread = std::thread([this] {
+      while (running.load(std::memory_order_relaxed)) {
+        bool busy = false;
+        {
+          std::lock_guard<std::mutex> guard(lock);
+          for (StreamVoice* v : voices) busy |= v->fill();
+        }
+        if (!busy) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    });
+  }
+
+  void stop() {
+    if (!running.exchange(false)) return;
+    thread.join();
+  }
+
+  void add(StreamVoice& voice) {
+    std::lock_guard<std::mutex> guard(lock);
+    voices.push_back(&voice);
+  }
+  void remove(StreamVoice& voice) {
+    std::lock_guard<std::mutex> guard(lock);
+    voices.erase(std::remove(voices.begin(), voices.end(), &voice), voices.end());
+  }
+};
+
+} // namespace ky
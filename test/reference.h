@@ -0,0 +1,157 @@
+#pragma once
+
+// Slow, double-precision versions of the ky units. These are what the golden
+// files in test/golden are rendered from; they follow the textbook definition
+// of each unit (exact phase, exact sine, double-precision coefficients) rather
+// than the tricks ky.h uses to be fast.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numbers>
+#include <vector>
+
+namespace reference {
+
+using Signal = std::vector<double>;
+
+constexpr double tau = 6.283185307179586476925286766559;
+
+// the LCG behind ky::uniform, without the signed overflow
+struct Noise {
+  uint32_t history = 0;
+  double operator()() {
+    history = history * 1103515245u + 12345u;
+    return static_cast<int32_t>(history) / 2147483647.0;
+  }
+};
+
+inline double frac(double x) { return x - std::floor(x); }
+
+inline Signal phasor(double hertz, double samplerate, int n) {
+  Signal y(n);
+  for (int i = 0; i < n; ++i) y[i] = frac(i * hertz / samplerate);
+  return y;
+}
+
+inline Signal cycle(double hertz, double samplerate, int n) {
+  Signal y(n);
+  for (int i = 0; i < n; ++i) y[i] = std::sin(tau * frac(i * hertz / samplerate));
+  return y;
+}
+
+// 1 on the samples where a timer of the given frequency fires: those where
+// the phase passes a whole number of cycles
+inline Signal timer(double hertz, double samplerate, int n) {
+  Signal y(n, 0.0);
+  for (int i = 0; i < n; ++i) {
+    y[i] = std::floor((i + 1) * hertz / samplerate) > std::floor(i * hertz / samplerate);
+  }
+  return y;
+}
+
+inline Signal onepole(const Signal& x, double hertz, double samplerate) {
+  double a1 = std::exp(-tau * hertz / samplerate), b0 = 1 - a1, y1 = 0;
+  Signal y(x.size());
+  for (size_t i = 0; i < x.size(); ++i) y[i] = y1 = b0 * x[i] + a1 * y1;
+  return y;
+}
+
+inline Signal mean(const Signal& x) {
+  Signal y(x.size());
+  double x1 = 0;
+  for (size_t i = 0; i < x.size(); ++i) {
+    y[i] = (x[i] + x1) / 2;
+    x1 = x[i];
+  }
+  return y;
+}
+
+inline Signal delta(const Signal& x) {
+  Signal y(x.size());
+  double x1 = 0;
+  for (size_t i = 0; i < x.size(); ++i) {
+    y[i] = x[i] - x1;
+    x1 = x[i];
+  }
+  return y;
+}
+
+inline Signal slew(const Signal& x, double start, double rate, double samplerate) {
+  Signal y(x.size());
+  double value = start, limit = rate / samplerate;
+  for (size_t i = 0; i < x.size(); ++i) {
+    y[i] = value;
+    value += std::fmax(-limit, std::fmin(limit, x[i] - value));
+  }
+  return y;
+}
+
+// read a (circular) delay line of the given size, samples_ago behind the
+// write head, with linear interpolation
+inline Signal delay(const Signal& x, size_t size, double samples_ago) {
+  Signal memory(size, 0.0), y(x.size());
+  size_t index = 0;
+  for (size_t i = 0; i < x.size(); ++i) {
+    memory[index] = x[i];
+    index = (index + 1) % size;
+    double at = frac((static_cast<double>(index) - samples_ago + size) / size) * size;
+    size_t left = static_cast<size_t>(at), right = (left + 1) % size;
+    double t = at - left;
+    y[i] = (1 - t) * memory[left] + t * memory[right];
+  }
+  return y;
+}
+
+inline Signal quasisaw(double hertz, double samplerate, double filter, int n) {
+  double w = hertz / samplerate, m = 0.5 - w;
+  double scaling = 13 * m * m * m * m, DC = 0.376 - w * 0.752, norm = 1 - 2 * w;
+  double osc = 0, phase = 0, history = 0;
+  Signal y(n);
+  for (int i = 0; i < n; ++i) {
+    phase += 2 * w;
+    if (phase >= 1) phase -= 2;
+    osc = (osc + std::sin(tau * (phase + osc * scaling * filter))) * 0.5;
+    y[i] = (2.5 * osc - 1.5 * history + DC) * norm;
+    history = osc;
+  }
+  return y;
+}
+
+// a Karplus-Strong string of the given size, plucked with noise; the loop
+// is a whole number of samples, a first-order allpass for the rest (exact at
+// the fundamental) and the two-sample mean, like ky::PluckedString
+inline Signal pluck(Noise& noise, size_t size, double hertz, double t60,
+                    double samplerate, int n) {
+  double gain = std::pow(std::pow(10.0, -60.0 / 20), 1 / (hertz * t60));
+  double loop = samplerate / hertz - 0.5;
+  double whole = std::max(1.0, std::floor(loop - 0.1));
+  double fraction = loop - whole;
+  double w = 2 * std::numbers::pi * hertz / samplerate;
+  double c = std::sin(w * (1 - fraction) / 2) /
+             std::sin(w * (1 + fraction) / 2);
+  size_t delay = static_cast<size_t>(whole);
+
+  Signal memory(size, 0.0), y(n);
+  size_t index = 0;
+  auto write = [&](double v) {
+    memory[index] = v;
+    index = (index + 1) % size;
+  };
+  for (size_t i = 0; i <= delay; ++i) write(noise());
+
+  double x1 = 0, y1 = 0, m1 = 0;
+  for (int i = 0; i < n; ++i) {
+    double x = memory[(index + size - delay) % size];
+    double a = c * (x - y1) + x1;
+    x1 = x;
+    y1 = a;
+    double v = (a + m1) / 2 * gain;
+    m1 = a;
+    write(v);
+    y[i] = v;
+  }
+  return y;
+}
+
+} // namespace reference
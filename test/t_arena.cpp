@@ -0,0 +1,31 @@
+#include <cstdint>
+#include <cstdio>
+
+#include "../ky.h"
+
+int main() {
+  ky::Arena arena;
+  ky::DelayLine a;
+  ky::PluckedString b;
+
+  // strings round their memory up to a power of two: 333 becomes 512
+  arena.reserve(ky::Arena::round(1001 * sizeof(float)) + ky::Arena::round(512 * sizeof(float)));
+  a.place(arena, 1001);
+  b.place(arena, 333);
+
+  // both lines come from the arena, on cache line boundaries, back to back
+  printf("%d %d\n", arena.owns(a.data()), arena.owns(b.data()));
+  printf("%lu %lu\n", uintptr_t(a.data()) % 64, uintptr_t(b.data()) % 64);
+  printf("%ld\n", (char*)b.data() - (char*)a.data());
+  printf("%lu of %lu bytes\n", arena.used(), arena.size());
+
+  // full; this one falls back to the heap
+  ky::DelayLine c;
+  c.place(arena, 10);
+  printf("%d\n", arena.owns(c.data()));
+
+  // laying out again reuses the block
+  arena.reset();
+  a.place(arena, 1001);
+  printf("%lu of %lu bytes\n", arena.used(), arena.size());
+}
@@ -0,0 +1,97 @@
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "../ky.h"
+
+// renders a grain cloud, a driven bank of modes and a resampled sine with
+// every kernel variant the host can run; each must give the same bits as
+// the baseline
+const int block = 256, blocks = 48000 * 5 / block;
+
+std::vector<float> grains() {
+  ky::ArrayFloat buffer;
+  buffer.resize(48000);
+  ky::Cycle cycle;
+  cycle.frequency(220, 48000);
+  for (auto& v : buffer) v = cycle();
+
+  ky::Granular cloud;
+  cloud.capacity(2048);
+  cloud.configure(48000);
+  cloud.density(20000);
+  cloud.duration(0.08f);
+  cloud.position(0.5f);
+  cloud.speed(1.01f);
+  cloud.gain(0.01f);
+
+  std::vector<float> out(static_cast<size_t>(block) * blocks, 0.0f);
+  for (int b = 0; b < blocks; ++b) cloud.render(buffer, out.data() + b * block, block);
+  return out;
+}
+
+std::vector<float> modes() {
+  ky::Modal bank;
+  bank.capacity(2000);
+  bank.configure(48000);
+  for (size_t i = 0; i < bank.capacity(); ++i) bank.mode(i, 50 + 7.3f * i, 1.5f, 0.01f);
+
+  // a noise burst every half second; not ky::uniform, whose state carries
+  // over from one variant to the next
+  uint32_t noise = 0;
+  std::vector<float> out(static_cast<size_t>(block) * blocks, 0.0f);
+  float in[block];
+  for (int b = 0; b < blocks; ++b) {
+    for (int i = 0; i < block; ++i) {
+      noise = noise * 1103515245u + 12345u;
+      in[i] = (b * block + i) % 24000 < 200 ? static_cast<int32_t>(noise) / 2147483648.0f : 0;
+    }
+    bank.render(in, out.data() + b * block, block);
+  }
+  return out;
+}
+
+std::vector<float> resampled() {
+  std::vector<float> source(48000 * 6);
+  for (size_t i = 0; i < source.size(); ++i) source[i] = static_cast<float>(std::sin(i * 0.05));
+  ky::Resampler resampler;
+  resampler.configure(ky::Resampler::Best, 1.5);
+  std::vector<float> out(static_cast<size_t>(block) * blocks, 0.0f);
+  double position = 0;
+  for (int b = 0; b < blocks; ++b) {
+    position = resampler.read(source.data(), source.size(), position, 1.2345, out.data() + b * block, block);
+  }
+  return out;
+}
+
+int main() {
+  printf("host supports %s\n", ky::name(ky::supported()));
+  std::vector<float> baseline[3];
+  bool ok = true;
+  for (ky::Isa isa : {ky::Isa::Baseline, ky::Isa::AVX2, ky::Isa::AVX512}) {
+    if (ky::dispatch(isa) != isa) continue;
+    std::vector<float> y[3];
+    double seconds[3];
+    int k = 0;
+    for (auto f : {grains, modes, resampled}) {
+      auto start = std::chrono::steady_clock::now();
+      y[k] = f();
+      seconds[k] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      ++k;
+    }
+    if (isa == ky::Isa::Baseline) {
+      for (int i = 0; i < 3; ++i) baseline[i] = y[i];
+    }
+    bool same = true;
+    for (int i = 0; i < 3; ++i) {
+      same &= std::memcmp(y[i].data(), baseline[i].data(), y[i].size() * sizeof(float)) == 0;
+    }
+    ok &= same;
+    printf("%-8s %s  grains %.3f s  modes %.3f s  sinc %.3f s\n", ky::name(isa),
+           same ? "same" : "DIFFERS", seconds[0], seconds[1], seconds[2]);
+  }
+  return ok ? 0 : 1;
+}
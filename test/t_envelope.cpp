@@ -0,0 +1,77 @@
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "../ky.h"
+
+// a note rendered in blocks against the same note a sample at a time,
+// the segment boundaries landing where they should, and the cost of many
+// envelopes while they sustain
+int main() {
+  const float SR = 48000;
+  const int block = 64;
+
+  // 10 ms attack, 100 ms decay to 0.5, released at 0.5 s over 200 ms
+  auto note = [&](ky::Envelope& env, int n, int step) {
+    std::vector<float> y(n);
+    env.configure(SR);
+    env.set(0.01f, 0.1f, 0.5f, 0.2f);
+    env.on();
+    std::vector<int> boundaries;
+    for (int i = 0; i < n; i += step) {
+      if (i == 24000) env.off();
+      int m = std::min(step, n - i);
+      if (env.until() <= m) boundaries.push_back(i + env.until());
+      env.render(y.data() + i, m);
+    }
+    return std::make_pair(y, boundaries);
+  };
+
+  ky::Envelope a, b;
+  auto [blocks, boundaries] = note(a, 48000, block);
+  auto [samples, unused] = note(b, 48000, 1);
+  double worst = 0;
+  for (int i = 0; i < 48000; ++i) worst = std::max(worst, std::fabs(double(blocks[i]) - samples[i]));
+  printf("blocks against samples: max difference %.1f dB\n", 20 * std::log10(worst + 1e-30));
+  assert(worst < 1e-5);
+
+  // attack ends on 480, decay on 480 + 4800, release on 24000 + 9600
+  for (int at : boundaries) printf("boundary at %d\n", at);
+  assert(boundaries.size() == 3);
+  assert(boundaries[0] == 480 && boundaries[1] == 5280 && boundaries[2] == 33600);
+  assert(blocks[479] == 1.0f && blocks[5279] == 0.5f && blocks[33599] == 0.0f);
+  assert(blocks[240] > 0.49f && blocks[240] < 0.51f);
+  assert(a.idle());
+
+  // process() reports the idle point inside its block
+  {
+    ky::Envelope env;
+    env.configure(SR);
+    env.set(0, 0, 1, 0.001f);  // 48 samples of release
+    env.on();
+    std::vector<float> x(block, 1.0f);
+    assert(env.process(x.data(), block) == block);
+    env.off();
+    int live = env.process(x.data(), block);
+    printf("released: live for %d of %d samples\n", live, block);
+    assert(live == 48 && x[47] == 0 && x[63] == 0);
+  }
+
+  // 1000 voices' envelopes scaling their blocks, mostly sustaining
+  std::vector<ky::Envelope> voices(1000);
+  for (auto& env : voices) {
+    env.configure(SR);
+    env.set(0.005f, 0.05f, 0.6f, 0.5f);
+    env.on();
+  }
+  std::vector<float> x(block, 1.0f);
+  auto start = std::chrono::steady_clock::now();
+  for (int n = 0; n < SR * 2; n += block) {
+    if (n == SR) for (auto& env : voices) env.off();
+    for (auto& env : voices) env.process(x.data(), block);
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  printf("1000 envelopes: %.4f of real time\n", seconds / 2);
+}
@@ -0,0 +1,109 @@
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#include "../ky.h"
+
+// collect the samples each event fires on, rendering in blocks of `block`
+std::vector<std::pair<int64_t, int>> run(ky::Scheduler& events, int blocks, int block) {
+  std::vector<std::pair<int64_t, int>> fired;
+  for (int b = 0; b < blocks; ++b) {
+    for (int done = 0; done < block;) {
+      ky::Event e;
+      while (events.due(e)) fired.push_back({events.time(), e.id});
+      int m = events.until(block - done);
+      events.advance(m);
+      done += m;
+    }
+  }
+  return fired;
+}
+
+int main() {
+  // a periodic event lands on ceil(k * period) whatever the block size
+  for (int block : {1, 64, 500}) {
+    ky::Scheduler events;
+    events.capacity(4);
+    events.every(48000 / 2.1, 0);
+    auto fired = run(events, 48000 * 100 / block, block);
+    for (size_t k = 0; k < fired.size(); ++k) {
+      assert(fired[k].first == static_cast<int64_t>(std::ceil(k * (48000 / 2.1))));
+    }
+    printf("block %3d: %zu plucks in 100 s, last on sample %lld\n", block, fired.size(),
+           static_cast<long long>(fired.back().first));
+  }
+
+  // one-shots in time order, and a full queue refuses more
+  {
+    ky::Scheduler events;
+    events.capacity(3);
+    assert(events.after(300, 3) && events.after(100, 1) && events.after(200.5, 2));
+    assert(events.capacity() == 3);
+    assert(!events.after(50, 4));
+    auto fired = run(events, 10, 64);
+    assert(fired.size() == 3);
+    assert(fired[0] == std::make_pair(int64_t{100}, 1));
+    assert(fired[1] == std::make_pair(int64_t{201}, 2));
+    assert(fired[2] == std::make_pair(int64_t{300}, 3));
+    assert(events.pending() == 0);
+  }
+
+  // quarter notes at 120 then 60 bpm; removing stops them
+  {
+    ky::Scheduler events;
+    events.capacity(4);
+    events.tempo(120, 48000);
+    events.synced(1, 7);
+    auto fired = run(events, 750, 64);  // 1 s: beats at 0 and 24000
+    assert(fired.size() == 2 && fired[1].first == 24000);
+    events.tempo(60, 48000);            // beat 2 is due now, then one a second
+    fired = run(events, 1500, 64);
+    assert(fired.size() == 2 && fired[0].first == 48000 && fired[1].first == 96000);
+    events.remove(7);
+    assert(run(events, 750, 64).empty());
+  }
+
+  // the processor's loop against polling a Timer every sample
+  const int block = 256, blocks = 48000 * 20 / block;
+  float out[block];
+  ky::PluckedString string;
+  string.resize(48000, 0);
+  double polled, scheduled;
+  {
+    ky::Timer timer;
+    timer.frequency(2.1, 48000);
+    auto start = std::chrono::steady_clock::now();
+    for (int b = 0; b < blocks; ++b) {
+      for (int i = 0; i < block; ++i) {
+        if (timer()) {
+          string.set(ky::map(ky::uniform(), -1, 1, 200, 2000), 0.5f);
+          string.pluck();
+        }
+        out[i] = string();
+      }
+    }
+    polled = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+  {
+    ky::Scheduler events;
+    events.capacity(8);
+    events.every(48000 / 2.1, 0);
+    auto start = std::chrono::steady_clock::now();
+    for (int b = 0; b < blocks; ++b) {
+      for (int done = 0; done < block;) {
+        ky::Event e;
+        while (events.due(e)) {
+          string.set(ky::map(ky::uniform(), -1, 1, 200, 2000), 0.5f);
+          string.pluck();
+        }
+        int m = events.until(block - done);
+        for (int i = done; i < done + m; ++i) out[i] = string();
+        events.advance(m);
+        done += m;
+      }
+    }
+    scheduled = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+  printf("20 s of plucks: polled %.3f s, scheduled %.3f s (%f)\n", polled, scheduled, out[0]);
+}
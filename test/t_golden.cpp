@@ -0,0 +1,396 @@
+// Renders each ky unit and checks it against the golden files in golden/,
+// which were rendered by the double-precision implementations in
+// reference.h. A sample passes when it is within the unit's ULP budget and
+// its absolute error is below the unit's dB floor. Units whose output swings
+// through zero have no ULP budget (a small absolute error is a huge number
+// of ulps of a value near zero) and are held to the floor alone; the budgets
+// are what each unit achieves, so a change that loses precision shows up.
+// Spectral checks measure
+// the noise floor of the sine oscillator and the aliasing of QuasiSaw.
+//
+//   make golden          # check; exits non-zero on any failure
+//   make golden-update   # re-render golden/ from reference.h
+//
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <string>
+
+#include "../ky.h"
+#include "reference.h"
+
+using reference::Signal;
+using Rendered = std::vector<float>;
+
+const int N = 2048;
+const float SR = 48000;
+
+///////////////////////////////////////////////////////////////////////////////
+//// Golden files /////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+std::string path(const char* name) { return std::string("golden/") + name + ".txt"; }
+
+bool save(const char* name, const Signal& y) {
+  FILE* file = fopen(path(name).c_str(), "w");
+  if (file == nullptr) return false;
+  for (double v : y) fprintf(file, "%.17g\n", v);
+  fclose(file);
+  return true;
+}
+
+Signal load(const char* name) {
+  Signal y;
+  FILE* file = fopen(path(name).c_str(), "r");
+  if (file == nullptr) return y;
+  double v;
+  while (fscanf(file, "%lf", &v) == 1) y.push_back(v);
+  fclose(file);
+  return y;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//// Error measures ///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+// floats as integers that are adjacent when the floats are adjacent
+int64_t ordered(float f) {
+  int32_t bits;
+  memcpy(&bits, &f, sizeof(bits));
+  return bits < 0 ? -static_cast<int64_t>(bits & 0x7fffffff) : bits;
+}
+
+int64_t ulps(float a, double b) {
+  int64_t d = ordered(a) - ordered(static_cast<float>(b));
+  return d < 0 ? -d : d;
+}
+
+double decibels(double a) { return a > 0 ? 20 * std::log10(a) : -400; }
+
+// a ULP budget that is not checked
+const int64_t anyUlps = -1;
+
+// circular signals (phases) are compared modulo 1
+bool compare(const char* name, const Rendered& y, const Signal& golden,
+             int64_t maxUlps, double maxDb, bool circular) {
+  if (golden.size() != y.size()) {
+    printf("%-10s FAIL  golden file has %zu samples, expected %zu\n", name,
+           golden.size(), y.size());
+    return false;
+  }
+  double floor = std::pow(10.0, maxDb / 20), worstError = 0;
+  int64_t worstUlps = 0;
+  size_t failures = 0;
+  for (size_t i = 0; i < y.size(); ++i) {
+    double error = std::fabs(y[i] - golden[i]);
+    int64_t u = ulps(y[i], golden[i]);
+    if (circular) {
+      error = std::fabs(error - std::round(error));
+      u = std::min(u, ulps(y[i], golden[i] + std::round(y[i] - golden[i])));
+    }
+    worstError = std::max(worstError, error);
+    worstUlps = std::max(worstUlps, u);
+    if ((maxUlps != anyUlps && u > maxUlps) || error > floor) ++failures;
+  }
+  printf("%-10s %-4s  %10lld ulp  %8.1f dB  ", name, failures ? "FAIL" : "ok",
+         static_cast<long long>(worstUlps), decibels(worstError));
+  if (maxUlps == anyUlps) {
+    printf("(limit %.0f dB)\n", maxDb);
+  } else {
+    printf("(limits %lld ulp and %.0f dB)\n", static_cast<long long>(maxUlps), maxDb);
+  }
+  return failures == 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//// Spectra //////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+// Hann-windowed power spectrum, bins 0..n/2; slow, but exact enough
+Signal spectrum(const Rendered& x) {
+  size_t n = x.size();
+  Signal c(n), s(n), w(n), power(n / 2 + 1);
+  for (size_t i = 0; i < n; ++i) {
+    c[i] = std::cos(reference::tau * i / n);
+    s[i] = std::sin(reference::tau * i / n);
+    w[i] = 0.5 - 0.5 * c[i];
+  }
+  for (size_t k = 0; k <= n / 2; ++k) {
+    double re = 0, im = 0;
+    for (size_t i = 0; i < n; ++i) {
+      size_t j = (k * i) % n;
+      re += w[i] * x[i] * c[j];
+      im -= w[i] * x[i] * s[j];
+    }
+    power[k] = re * re + im * im;
+  }
+  return power;
+}
+
+// energy outside the given bins (and their window main lobes), relative
+// to the energy inside them; DC and its main lobe are ignored
+double outside(const Signal& power, const std::vector<size_t>& bins) {
+  std::vector<bool> mask(power.size(), false);
+  for (size_t b : bins)
+    for (size_t k = (b > 2 ? b - 2 : 0); k <= b + 2 && k < power.size(); ++k)
+      mask[k] = true;
+  double in = 0, out = 0;
+  for (size_t k = 3; k < power.size(); ++k) (mask[k] ? in : out) += power[k];
+  return 10 * std::log10(out / in);
+}
+
+bool below(const char* name, double measured, double limit) {
+  bool ok = measured <= limit;
+  printf("%-10s %-4s  %8.1f dB  (limit %.0f dB)\n", name, ok ? "ok" : "FAIL",
+         measured, limit);
+  return ok;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//// Units ////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+// test input shared by the filters; not ky::uniform, so the units that do
+// use it see the same sequence as the reference
+Rendered input() {
+  reference::Noise noise;
+  Rendered x(N);
+  for (auto& v : x) v = static_cast<float>(noise());
+  return x;
+}
+
+Signal widen(const Rendered& x) { return Signal(x.begin(), x.end()); }
+
+template <typename F>
+Rendered render(F&& f) {
+  Rendered y(N);
+  for (int i = 0; i < N; ++i) y[i] = f(i);
+  return y;
+}
+
+struct Unit {
+  const char* name;
+  int64_t ulps;
+  double db;
+  std::function<Rendered()> ky;
+  std::function<Signal()> reference;
+  bool circular = false;
+};
+
+reference::Noise noise;  // mirrors ky::uniform
+
+std::vector<Unit> units = {
+    {"uniform", 0, -140,
+     [] { return render([](int) { return ky::uniform(); }); },
+     [] {
+       Signal y(N);
+       for (auto& v : y) v = noise();
+       return y;
+     }},
+    {"pluck", anyUlps, -90,
+     [] {
+       ky::PluckedString string;
+       string.resize(ky::PluckedString::samples(300, SR), 0);
+       string.configure(SR);
+       string.set(300, 0.7);
+       string.pluck();
+       return render([&](int) { return string(); });
+     },
+     [] { return reference::pluck(noise, ky::PluckedString::samples(300, SR), 300, 0.7, SR, N); }},
+    {"phasor", anyUlps, -120,
+     [] {
+       ky::Phasor phasor;
+       phasor.frequency(440, SR);
+       return render([&](int) { return phasor(); });
+     },
+     [] { return reference::phasor(440, SR, N); },
+     true},
+    {"timer", 0, -400,
+     [] {
+       ky::Timer timer;
+       timer.frequency(1234, SR);
+       return render([&](int) { return timer() ? 1.0f : 0.0f; });
+     },
+     [] { return reference::timer(1234, SR, N); }},
+    {"cycle", anyUlps, -110,
+     [] {
+       ky::Cycle cycle;
+       cycle.frequency(440, SR);
+       return render([&](int) { return cycle(); });
+     },
+     [] { return reference::cycle(440, SR, N); }},
+    {"sint", 0, -140,
+     [] { return render([](int i) { return ky::sint(i / float(N)); }); },
+     [] { return reference::cycle(SR / N, SR, N); }},
+    // a crude approximation; gated so it does not get worse
+    {"sin7", anyUlps, -25,
+     [] { return render([](int i) { return ky::sin7(i / float(N)); }); },
+     [] { return reference::cycle(SR / N, SR, N); }},
+    {"onepole", 512, -120,
+     [] {
+       ky::OnePole filter;
+       filter.frequency(1000, SR);
+       Rendered x = input();
+       return render([&](int i) { return filter(x[i]); });
+     },
+     [] { return reference::onepole(widen(input()), 1000, SR); }},
+    {"mean", 0, -140,
+     [] {
+       ky::TwoSampleMean filter;
+       Rendered x = input();
+       return render([&](int i) { return filter(x[i]); });
+     },
+     [] { return reference::mean(widen(input())); }},
+    {"delta", 0, -140,
+     [] {
+       ky::Delta delta;
+       Rendered x = input();
+       return render([&](int i) { return delta(x[i]); });
+     },
+     [] { return reference::delta(widen(input())); }},
+    {"slew", 1024, -120,
+     [] {
+       ky::SlewRateLimit filter;
+       filter.configure(-1, 2000, SR);
+       Rendered x = input();
+       return render([&](int i) { return filter(x[i]); });
+     },
+     [] { return reference::slew(widen(input()), -1, 2000, SR); }},
+    {"delay", 1024, -140,
+     [] {
+       ky::DelayLine line;
+       line.resize(1000, 0);
+       Rendered x = input();
+       return render([&](int i) {
+         line.write(x[i]);
+         return line.read(100.37f);
+       });
+     },
+     [] { return reference::delay(widen(input()), 1000, 100.37f); }},
+    {"quasisaw", anyUlps, -50,
+     [] {
+       ky::QuasiSaw saw;
+       saw.frequency(615, SR);
+       saw.virtualfilter(0.45f);
+       return render([&](int) { return saw(); });
+     },
+     [] { return reference::quasisaw(615, SR, 0.45, N); }},
+};
+
+// error power of a delay line stored as S, relative to the signal, for a
+// half-scale sine plus noise read at a fractional delay
+template <typename S>
+double storage() {
+  ky::BasicDelayLine<S> line;
+  ky::DelayLine exact;
+  line.resize(1000);
+  exact.resize(1000);
+  Rendered x = input();
+  double signal = 0, error = 0;
+  for (int i = 0; i < N; ++i) {
+    float v = 0.5f * std::sin(reference::tau * 997 * i / SR) + 0.1f * x[i];
+    line.write(v);
+    exact.write(v);
+    double a = line.read(100.37f), b = exact.read(100.37f);
+    signal += b * b;
+    error += (a - b) * (a - b);
+  }
+  return 10 * std::log10(error / signal);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//// Main /////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char* argv[]) {
+  if (argc > 1 && std::string(argv[1]) == "write") {
+    for (auto& unit : units) {
+      if (!save(unit.name, unit.reference())) {
+        printf("could not write %s\n", path(unit.name).c_str());
+        return 1;
+      }
+    }
+    return 0;
+  }
+
+  bool ok = true;
+  for (auto& unit : units) {
+    ok &= compare(unit.name, unit.ky(), load(unit.name), unit.ulps, unit.db,
+                  unit.circular);
+  }
+
+  // block writes and reads of a delay line match the per-sample ones bit
+  // for bit
+  {
+    ky::DelayLine line, blocks;
+    line.resize(1000, 0);
+    blocks.resize(1000, 0);
+    Rendered x = input(), y(N);
+    Signal expected(N);
+    for (int i = 0; i < N; ++i) {
+      expected[i] = line.read(100.37f);
+      line.write(x[i]);
+    }
+    for (int i = 0; i < N; i += 64) {
+      blocks.read(100.37f, y.data() + i, 64);
+      blocks.write(x.data() + i, 64);
+    }
+    ok &= compare("delay/blk", y, expected, 0, -400, false);
+  }
+
+  // noise floor of the compressed delay memory formats against float
+  ok &= below("delay/q15", storage<ky::Fixed16>(), -85);
+  ok &= below("delay/half", storage<ky::Half>(), -60);
+
+  // half storage gives the same bits whether or not the build has F16C:
+  // block encode() against the scalar path, at and around the edges
+  {
+    const float inf = std::numeric_limits<float>::infinity();
+    std::vector<float> edges = {0.0f, -0.0f, 1.0f, 6.1e-5f, 5.9e-8f, 2e-8f, 65504.0f, 65519.0f,
+                                65520.0f, 65535.0f, 65536.0f, 1e9f, inf, -65520.0f, -inf,
+                                std::numeric_limits<float>::quiet_NaN(),
+                                std::bit_cast<float>(0xff812345u)};
+    edges.resize(32, 0.25f);  // whole 8-sample blocks
+    std::vector<ky::Half> blocks(edges.size());
+    ky::encode(edges.data(), blocks.data(), edges.size());
+    std::vector<float> back(edges.size());
+    ky::decode(blocks.data(), back.data(), edges.size());
+    bool same = true;
+    for (size_t i = 0; i < edges.size(); ++i) {
+      ky::Half h = ky::Format<ky::Half>::encode(edges[i]);
+      float f = ky::Format<ky::Half>::decode(h);
+      same &= h.bits == blocks[i].bits;
+      same &= std::bit_cast<uint32_t>(f) == std::bit_cast<uint32_t>(back[i]);
+      same &= !std::isinf(f);
+    }
+    uint16_t top = ky::Format<ky::Half>::encode(65535.0f).bits;
+    same &= top == 0x7bff;  // saturates rather than rounding up to inf
+    printf("%-10s %s  (65535 stored as 0x%04x)\n", "half/edges", same ? "ok  " : "FAIL", top);
+    ok &= same;
+  }
+
+  // 4800 samples at 48 kHz puts every multiple of 10 Hz on a bin
+  {
+    ky::Cycle cycle;
+    cycle.frequency(1000, SR);
+    Rendered y(4800);
+    for (auto& v : y) v = cycle();
+    ok &= below("cycle/nf", outside(spectrum(y), {100}), -130);
+  }
+  {
+    // QuasiSaw's phase spans [-1, 1), so it sounds at twice the frequency
+    // it is given: 615 Hz puts the fundamental on bin 123
+    ky::QuasiSaw saw;
+    saw.frequency(615, SR);
+    saw.virtualfilter(0.45f);
+    Rendered y(4800);
+    for (auto& v : y) v = saw();
+    std::vector<size_t> harmonics;
+    for (size_t k = 123; k < 2400; k += 123) harmonics.push_back(k);
+    ok &= below("saw/alias", outside(spectrum(y), harmonics), -25);
+  }
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,105 @@
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+#include "../ky.h"
+
+// a cloud of grains over a loaded buffer, dense enough to keep 1000+
+// grains alive, then grains over a live delay line; prints the pool size
+// and how much of real time rendering takes; then rates that run
+// backwards or past a whole buffer per block, and density set before the
+// sample rate
+int main() {
+  const int block = 256;
+  float out[block];
+
+  ky::ArrayFloat buffer;
+  buffer.resize(48000);
+  ky::Cycle cycle;
+  cycle.frequency(220, 48000);
+  for (auto& v : buffer) v = cycle();
+
+  ky::Granular cloud;
+  cloud.capacity(2048);
+  cloud.configure(48000);
+  cloud.density(20000);
+  cloud.duration(0.08f);
+  cloud.position(0.5f, 2000);
+  cloud.speed(1, 0.1f);
+  cloud.gain(0.01f);
+
+  for (int b = 0; b < 20; ++b) cloud.render(buffer, out, block);
+  printf("%zu grains of %zu\n", cloud.grains(), cloud.capacity());
+
+  const int blocks = 48000 * 10 / block;
+  auto start = std::chrono::steady_clock::now();
+  for (int b = 0; b < blocks; ++b) {
+    for (auto& v : out) v = 0;
+    cloud.render(buffer, out, block);
+  }
+  auto end = std::chrono::steady_clock::now();
+  printf("%zu grains: %.3f of real time\n", cloud.grains(),
+         std::chrono::duration<double>(end - start).count() / 10);
+
+  ky::DelayLine line;
+  line.resize(48000);
+  ky::Granular live;
+  live.capacity(64);
+  live.configure(48000);
+  live.density(100);
+  live.duration(0.05f);
+  live.position(4800);
+  for (int b = 0; b < 40; ++b) {
+    float in[block];
+    for (auto& v : in) v = cycle();
+    line.write(in, block);
+    for (auto& v : out) v = 0;
+    live.render(line, out, block);
+  }
+  for (int i = 0; i < block; i += 32) printf("%lf\n", out[i]);
+
+  // reverse and very fast grains over a short buffer stay inside it (run
+  // under -fsanitize=address to see it) and give bounded output
+  {
+    ky::ArrayFloat tiny;
+    tiny.resize(300);
+    for (auto& v : tiny) v = cycle();
+    for (float speed : {-1.0f, 1.0f, 2.5f, 7.0f}) {
+      ky::Granular wild;
+      wild.capacity(64);
+      wild.configure(48000);
+      wild.density(2000);
+      wild.duration(0.02f);
+      wild.position(0.9f, 500);
+      wild.speed(speed, 1.5f);
+      wild.gain(0.1f);
+      float worst = 0;
+      for (int b = 0; b < 200; ++b) {
+        for (auto& v : out) v = 0;
+        wild.render(tiny, out, block);
+        for (float v : out) worst = std::fmax(worst, std::fabs(v));
+      }
+      printf("speed %4.1f: peak %.3f\n", speed, worst);
+      assert(std::isfinite(worst) && worst <= 0.1f * 64);
+    }
+  }
+
+  // density() before configure() follows the rate configure() sets
+  {
+    ky::Granular before, after;
+    before.capacity(64);
+    after.capacity(64);
+    before.density(100);
+    before.configure(96000);
+    after.configure(96000);
+    after.density(100);
+    float a[block] = {}, b[block] = {};
+    for (int k = 0; k < 40; ++k) {
+      before.render(buffer, a, block);
+      after.render(buffer, b, block);
+    }
+    printf("density before configure: %zu grains, after: %zu\n", before.grains(), after.grains());
+    assert(before.grains() == after.grains());
+  }
+}
@@ -0,0 +1,66 @@
+#include <cstdio>
+#include <thread>
+
+#include "../graph.h"
+
+// two cycles through a gain and a one-pole, mixed; then the same graph is
+// repatched while another thread keeps rendering it
+int main() {
+  ky::Graph graph;
+  int a = graph.add<ky::UnitNode<ky::Cycle>>();
+  int b = graph.add<ky::UnitNode<ky::Cycle>>();
+  int filter = graph.add<ky::UnitNode<ky::OnePole>>();
+  int volume = graph.add<ky::ValueNode>();
+  int gain = graph.add<ky::GainNode>();
+  int mix = graph.add<ky::MixNode>(2);
+
+  static_cast<ky::UnitNode<ky::Cycle>&>(graph.node(a)).unit.frequency(440, 48000);
+  static_cast<ky::UnitNode<ky::Cycle>&>(graph.node(b)).unit.frequency(660, 48000);
+  static_cast<ky::UnitNode<ky::OnePole>&>(graph.node(filter)).unit.frequency(1000, 48000);
+  static_cast<ky::ValueNode&>(graph.node(volume)).value = 0.5f;
+
+  graph.connect(a, 0, gain, 0);
+  graph.connect(volume, 0, gain, 1);
+  graph.connect(b, 0, filter, 0);
+  graph.connect(gain, 0, mix, 0);
+  graph.connect(filter, 0, mix, 1);
+  graph.output(mix, 0);
+
+  try {
+    graph.connect(a, 0, gain, 1);
+  } catch (const std::invalid_argument& e) {
+    printf("%s\n", e.what());
+  }
+
+  for (int block : {0, -1}) {
+    try {
+      graph.compile(block);
+      printf("compile(%d) was accepted\n", block);
+      return 1;
+    } catch (const std::invalid_argument& e) {
+      printf("%s\n", e.what());
+    }
+  }
+
+  auto schedule = graph.compile(64);
+  printf("%d buffers for 6 nodes\n", schedule->bufferCount());
+
+  float left[100];
+  float* out[] = {left};
+  schedule->process(out, 1, 100);
+  for (int i = 0; i < 100; i += 10) printf("%lf\n", left[i]);
+
+  ky::Patch patch;
+  patch.swap(graph.compile(64));
+  std::atomic<bool> running{true};
+  std::thread audio([&] {
+    float block[256];
+    float* o[] = {block};
+    while (running) patch.process(o, 1, 256);
+  });
+  for (int i = 0; i < 1000; ++i) patch.swap(graph.compile(64 + i % 7));
+  running = false;
+  audio.join();
+  patch.collect();
+  printf("%zu retired schedules left\n", patch.pending());
+}
@@ -0,0 +1,84 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+#include "../ky.h"
+
+// a struck mode against its closed form, an undamped mode after a minute,
+// decayed modes dropping out, a string through a body of modes, and how
+// much of real time a few thousand modes take
+int main() {
+  const float SR = 48000;
+  const int block = 64;
+  float out[block];
+
+  {
+    ky::Modal bank;
+    bank.capacity(1);
+    bank.configure(SR);
+    bank.mode(0, 440, 0.5f, 0.8f);
+    bank.strike();
+    double r = std::pow(10.0, -3.0 / (0.5 * SR)), w = 2 * M_PI * 440 / SR, worst = 0;
+    for (int n = 0; n < SR; n += block) {
+      std::fill(out, out + block, 0.0f);
+      bank.render(out, block);
+      for (int i = 0; i < block; ++i) {
+        double expected = 0.8 * std::pow(r, n + i + 1) * std::sin(w * (n + i + 1));
+        worst = std::max(worst, std::fabs(out[i] - expected));
+      }
+    }
+    printf("struck mode: max error %.1f dB\n", 20 * std::log10(worst));
+  }
+
+  {
+    ky::Modal bank;
+    bank.capacity(1);
+    bank.configure(SR);
+    bank.mode(0, 1234.5f, 0);
+    bank.strike();
+    float peak = 0;
+    for (int n = 0; n < 60 * SR; n += block) {
+      std::fill(out, out + block, 0.0f);
+      bank.render(out, block);
+      if (n >= 59 * SR)
+        for (float v : out) peak = std::max(peak, std::fabs(v));
+    }
+    printf("undamped mode after 60 s: peak %.6f\n", peak);
+  }
+
+  ky::Modal body;
+  body.capacity(4000);
+  body.configure(SR);
+  for (size_t i = 0; i < body.capacity(); ++i) {
+    float hertz = 100 + 5 * i * (1 + 0.001f * (i % 7));
+    body.mode(i, hertz, 2.0f * 200 / (200 + hertz), 0.01f);
+  }
+
+  {
+    ky::PluckedString string;
+    string.resize(48000, 0);
+    string.set(196, 0.5f);
+    string.pluck();
+    float in[block];
+    double energy = 0;
+    for (int n = 0; n < SR / 2; n += block) {
+      for (auto& v : in) v = string();
+      std::fill(out, out + block, 0.0f);
+      body.render(in, out, block);
+      for (float v : out) energy += v * v;
+    }
+    printf("string into %zu modes: %zu running, rms %.4f\n", body.capacity(),
+           body.running(), std::sqrt(energy / (SR / 2)));
+  }
+
+  body.clear();
+  body.strike();
+  auto start = std::chrono::steady_clock::now();
+  for (int n = 0; n < SR; n += block) body.render(out, block);
+  auto end = std::chrono::steady_clock::now();
+  printf("%zu modes: %.3f of real time\n", body.capacity(),
+         std::chrono::duration<double>(end - start).count());
+
+  for (int n = 0; n < 20 * SR; n += block) body.render(out, block);
+  printf("after 20 s: %zu modes running\n", body.running());
+}
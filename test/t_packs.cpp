@@ -0,0 +1,227 @@
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "../ky.h"
+#include "reference.h"
+
+// every lane of a pack plays what the float unit plays with that lane's
+// settings, double units follow the reference closely, and a pack of eight
+// voices against eight float voices.
+//
+// The lanes match bit for bit only when the compiler does not contract
+// a * b + c into an FMA (-ffp-contract=off, which `make packs` builds
+// with and defines EXACT); with contraction, e.g. -march=native under GCC,
+// the scalar and pack loops may fuse different operations, so they are
+// held to a tolerance instead.
+#ifdef EXACT
+const double tolerance = 0;
+#else
+const double tolerance = 1e-5;
+#endif
+
+const int N = 4096;
+const int L = 8;
+const float SR = 48000;
+
+float hertz(int l) { return 110.0f * (l + 1) + 3.7f * l; }
+
+// per-lane settings: a pack gets every lane's value, a voice its own
+ky::float8 spread(float (*f)(int)) {
+  ky::float8 p;
+  for (int l = 0; l < L; ++l) ky::lane(p, l) = f(l);
+  return p;
+}
+
+// render a float unit per lane and a pack unit and compare them, within
+// the tolerance; setup gets the lane's frequency, or the pack of them
+template <typename Scalar, typename Packed, typename Setup, typename Run>
+bool lockstep(const char* name, Setup setup, Run run) {
+  Scalar voices[L];
+  Packed pack;
+  for (int l = 0; l < L; ++l) setup(voices[l], hertz(l));
+  setup(pack, spread(hertz));
+  std::vector<float> x(N);
+  reference::Noise noise;
+  for (auto& v : x) v = static_cast<float>(noise());
+  double worst = 0;
+  for (int i = 0; i < N; ++i) {
+    ky::float8 y = run(pack, ky::float8(x[i]));
+    for (int l = 0; l < L; ++l) worst = std::fmax(worst, std::fabs(double(ky::lane(y, l)) - run(voices[l], x[i])));
+  }
+  bool ok = worst <= tolerance;
+  printf("%-14s %s  (%s)\n", name, ok ? "ok  " : "FAIL", worst == 0 ? "exact" : "within tolerance");
+  if (!ok) printf("               differ by up to %g\n", worst);
+  return ok;
+}
+
+double worst(const std::vector<double>& a, const reference::Signal& b) {
+  double w = 0;
+  for (size_t i = 0; i < a.size(); ++i) w = std::max(w, std::fabs(a[i] - b[i]));
+  return w > 0 ? 20 * std::log10(w) : -400;
+}
+
+int main() {
+  bool ok = true;
+
+  ok &= lockstep<ky::Phasor, ky::BasicPhasor<ky::float8>>(
+      "phasor",
+      [](auto& u, auto hz) { u.frequency(hz, SR); },
+      [](auto& u, auto) { return u(); });
+
+  ok &= lockstep<ky::QuasiSaw, ky::BasicQuasiSaw<ky::float8>>(
+      "quasisaw",
+      [](auto& u, auto hz) {
+        u.frequency(hz, SR);
+        u.virtualfilter(0.45f);
+      },
+      [](auto& u, auto) { return u(); });
+
+  ok &= lockstep<ky::OnePole, ky::BasicOnePole<ky::float8>>(
+      "onepole",
+      [](auto& u, auto hz) { u.frequency(hz * 4.0f, SR); },
+      [](auto& u, auto x) { return u(x); });
+
+  ok &= lockstep<ky::SlewRateLimit, ky::BasicSlewRateLimit<ky::float8>>(
+      "slew",
+      [](auto& u, auto hz) { u.configure(0.0f, hz * 10.0f, SR); },
+      [](auto& u, auto x) { return u(x); });
+
+  ok &= lockstep<ky::Delta, ky::BasicDelta<ky::float8>>(
+      "delta", [](auto&, auto) {}, [](auto& u, auto x) { return u(x); });
+
+  ok &= lockstep<ky::History, ky::BasicHistory<ky::float8>>(
+      "history", [](auto&, auto) {}, [](auto& u, auto x) { return u(x); });
+
+  ok &= lockstep<ky::TwoSampleMean, ky::BasicTwoSampleMean<ky::float8>>(
+      "mean", [](auto&, auto) {}, [](auto& u, auto x) { return u(x); });
+
+  // plucked one lane at a time; each voice is handed its lane's noise
+  // (the string's memory is its buffer), as the noise can't be replayed
+  {
+    ky::PluckedString voices[L];
+    ky::BasicPluckedString<ky::float8> pack;
+    auto decay = [](int l) { return 0.3f + 0.1f * l; };
+    pack.resize(ky::PluckedString::samples(100, SR));
+    pack.configure(SR);
+    ky::float8 t60;
+    for (int l = 0; l < L; ++l) ky::lane(t60, l) = decay(l);
+    pack.set(spread(hertz), t60);
+    for (int l = 0; l < L; ++l) {
+      voices[l].resize(ky::PluckedString::samples(100, SR));
+      voices[l].configure(SR);
+      voices[l].set(hertz(l), decay(l));
+    }
+    double worst = 0;
+    for (int i = 0; i < N; ++i) {
+      // a lane plucked while the others play leaves them undisturbed
+      if (i % 1000 == 0) {
+        int l = (i / 1000) % L;
+        pack.pluck(0.8f, l);
+        for (size_t k = 0; k < pack.size(); ++k) voices[l][k] = ky::lane(pack[k], l);
+      }
+      ky::float8 y = pack();
+      for (int l = 0; l < L; ++l) worst = std::fmax(worst, std::fabs(double(ky::lane(y, l)) - voices[l]()));
+    }
+    printf("%-14s %s  (%s)\n", "pluck", worst <= tolerance ? "ok  " : "FAIL",
+           worst == 0 ? "exact" : "within tolerance");
+    ok &= worst <= tolerance;
+  }
+
+  // in double, the filters track the double-precision references closely
+  {
+    reference::Noise noise;
+    reference::Signal x(N);
+    for (auto& v : x) v = noise();
+    std::vector<double> y(N);
+
+    ky::BasicOnePole<double> onepole;
+    onepole.frequency(1000, SR);
+    for (int i = 0; i < N; ++i) y[i] = onepole(x[i]);
+    double error = worst(y, reference::onepole(x, 1000, SR));
+    printf("%-14s %6.1f dB\n", "onepole/double", error);
+    ok &= error < -250;
+
+    ky::BasicQuasiSaw<double> saw;
+    saw.frequency(615, SR);
+    saw.virtualfilter(0.45);
+    for (int i = 0; i < N; ++i) y[i] = saw();
+    error = worst(y, reference::quasisaw(615, SR, 0.45, N));
+    printf("%-14s %6.1f dB\n", "quasisaw/double", error);
+    ok &= error < -250;
+
+    ky::BasicSlewRateLimit<double> slew;
+    slew.configure(-1, 2000, SR);
+    for (int i = 0; i < N; ++i) y[i] = slew(x[i]);
+    error = worst(y, reference::slew(x, -1, 2000, SR));
+    printf("%-14s %6.1f dB\n", "slew/double", error);
+    ok &= error < -250;
+
+    // a double holds the whole 32-bit phase: exactly i * step / 2^32
+    ky::BasicPhasor<double> phasor;
+    phasor.frequency(440, SR);
+    uint32_t step = ky::increment(440, SR);
+    bool exact = true;
+    for (int i = 0; i < N; ++i) exact &= phasor() == uint32_t(i * step) / 4294967296.0;
+    printf("%-14s %s\n", "phasor/double", exact ? "ok" : "FAIL");
+    ok &= exact;
+  }
+
+  // eight voices of QuasiSaw and PluckedString: one pack against eight units
+  {
+    using clock = std::chrono::steady_clock;
+    const int samples = 48000 * 4;
+    volatile float sink = 0;
+    auto time = [&](auto&& f) {
+      auto start = clock::now();
+      f();
+      return std::chrono::duration<double>(clock::now() - start).count();
+    };
+
+    ky::QuasiSaw saws[L];
+    ky::BasicQuasiSaw<ky::float8> saw8;
+    for (int l = 0; l < L; ++l) saws[l].frequency(hertz(l), SR);
+    saw8.frequency(spread(hertz), SR);
+    double scalar = time([&] {
+      float s = 0;
+      for (int i = 0; i < samples; ++i)
+        for (auto& u : saws) s += u();
+      sink = s;
+    });
+    double packed = time([&] {
+      ky::float8 s = 0;
+      for (int i = 0; i < samples; ++i) s += saw8();
+      sink = ky::lane(s, 0);
+    });
+    printf("quasisaw x8: float %.3f s, float8 %.3f s\n", scalar, packed);
+
+    ky::PluckedString strings[L];
+    ky::BasicPluckedString<ky::float8> string8;
+    for (int l = 0; l < L; ++l) {
+      strings[l].resize(ky::PluckedString::samples(100, SR));
+      strings[l].configure(SR);
+      strings[l].set(hertz(l), 2);
+      strings[l].pluck();
+    }
+    string8.resize(ky::PluckedString::samples(100, SR));
+    string8.configure(SR);
+    string8.set(spread(hertz), 2.0f);
+    string8.pluck();
+    scalar = time([&] {
+      float s = 0;
+      for (int i = 0; i < samples; ++i)
+        for (auto& u : strings) s += u();
+      sink = s;
+    });
+    packed = time([&] {
+      ky::float8 s = 0;
+      for (int i = 0; i < samples; ++i) s += string8();
+      sink = ky::lane(s, 0);
+    });
+    printf("pluck x8:    float %.3f s, float8 %.3f s\n", scalar, packed);
+  }
+
+  return ok ? 0 : 1;
+}
@@ -1,12 +1,67 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
 #include "../ky.h"
 
+// the pitch of a plucked string in cents off the requested frequency: the
+// autocorrelation peaks where the lag is a whole number of periods, so find
+// the peak nearest a tenth of a second's worth of them (refined with a
+// parabola through its neighbours) and divide by how many periods it is
+double cents(float hertz, float samplerate) {
+  ky::PluckedString string;
+  string.resize(ky::PluckedString::samples(hertz, samplerate));
+  string.configure(samplerate);
+  string.set(hertz, 4);
+  string.pluck();
+
+  std::vector<double> x(static_cast<size_t>(samplerate / 2));
+  for (auto& v : x) v = string();
+
+  auto correlation = [&](int lag) {
+    double sum = 0;
+    for (size_t i = 0; i + lag < x.size(); ++i) sum += x[i] * x[i + lag];
+    return sum;
+  };
+
+  double period = samplerate / hertz;
+  int periods = std::max(1, static_cast<int>(hertz / 10));
+  double expected = period * periods;
+  int best = 0;
+  double peak = -1;
+  for (int lag = static_cast<int>(expected - period / 4);
+       lag <= static_cast<int>(expected + period / 4) + 1; ++lag) {
+    double r = correlation(lag);
+    if (r > peak) {
+      peak = r;
+      best = lag;
+    }
+  }
+  double a = correlation(best - 1), b = peak, c = correlation(best + 1);
+  double measured = (best + 0.5 * (a - c) / (a - 2 * b + c)) / periods;
+  return 1200 * std::log2(period / measured);
+}
+
+// the first samples of a string at 300 Hz; then, for each rate and
+// frequency, how far the string's pitch is from the one asked for
 int main() {
   ky::PluckedString string;
-  string.resize(48000, 0);
+  string.resize(ky::PluckedString::samples(300, 48000));
+  string.configure(48000);
   string.set(300, 0.7);
   string.pluck();
 
   for (int i = 0; i < 100; i++) {
     printf("%lf\n", string());
   }
+
+  for (float rate : {44100.0f, 48000.0f, 96000.0f}) {
+    for (float hertz : {55.0f, 110.0f, 220.0f, 440.0f, 1000.0f, 2000.0f}) {
+      double off = cents(hertz, rate);
+      printf("%6.0f Hz at %6.0f: %+.3f cents\n", hertz, rate, off);
+      assert(std::fabs(off) < 0.15);
+    }
+  }
 }
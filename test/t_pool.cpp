@@ -0,0 +1,110 @@
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include "../ky.h"
+#include "../pool.h"
+
+// 8 detuned cycles split across the pool; prints the mixed output
+ky::Cycle voice[8];
+
+void render(void*, int p, int n, float* out, int frames) {
+  for (int v = p; v < 8; v += n) {
+    for (int i = 0; i < frames; ++i) {
+      out[i] += voice[v]();
+    }
+  }
+}
+
+// plucked strings, each with its own noise, plucked in turn every 300
+// samples; the state of every voice belongs to that voice alone
+struct Strings {
+  static constexpr int voices = 8;
+  ky::PluckedString string[voices];
+  ky::Noise noise[voices];
+  int time = 0;  // samples rendered before this block
+
+  Strings() {
+    for (int v = 0; v < voices; ++v) {
+      string[v].resize(ky::PluckedString::samples(100, 48000));
+      string[v].configure(48000);
+      noise[v] = ky::Noise(static_cast<uint32_t>(v) * 2654435761u + 1u);
+    }
+  }
+};
+
+void strings(void* context, int p, int n, float* out, int frames) {
+  auto& s = *static_cast<Strings*>(context);
+  for (int v = p; v < Strings::voices; v += n) {
+    for (int i = 0; i < frames; ++i) {
+      int t = s.time + i;
+      if (t % 300 == 0 && (t / 300) % Strings::voices == v) {
+        s.string[v].set(110.0f * (v + 1), 0.5f);
+        s.string[v].pluck(s.noise[v]);
+      }
+      out[i] += s.string[v]();
+    }
+  }
+}
+
+void count(void* context, int, int, float* out, int frames) {
+  static_cast<std::atomic<int>*>(context)->fetch_add(1);
+  for (int i = 0; i < frames; ++i) out[i] += 1;
+}
+
+int main() {
+  for (int v = 0; v < 8; ++v) {
+    voice[v].frequency(220.0f * (v + 1), 48000);
+  }
+
+  ky::RenderPool pool;
+  pool.start(3, 256);
+
+  float block[256];
+  for (int b = 0; b < 4; ++b) {
+    pool.render(render, nullptr, block, 256);
+    for (int i = 0; i < 256; i += 32) {
+      printf("%lf\n", block[i]);
+    }
+  }
+  pool.stop();
+
+  // render() and stop() straight after start(), before the workers have
+  // had a chance to run, must neither hang nor lose a partition
+  for (int k = 0; k < 1000; ++k) {
+    std::atomic<int> calls{0};
+    pool.start(2, 256);
+    pool.render(count, &calls, block, 256);
+    assert(calls == 3);
+    assert(block[0] == 3 && block[255] == 3);
+    pool.stop();
+    pool.start(2, 256);
+    pool.stop();
+  }
+  printf("start, render and stop back to back: ok\n");
+
+  // pooled voices give exactly what rendering the same partitions one
+  // after another on this thread gives
+  {
+    const int workers = 3, n = workers + 1, frames = 256;
+    Strings pooled, serial;
+    pool.start(workers, frames);
+    float mixed[frames], expected[frames], part[frames];
+    bool same = true;
+    for (int b = 0; b < 400; ++b) {
+      pool.render(strings, &pooled, mixed, frames);
+      pooled.time += frames;
+      for (int p = 0; p < n; ++p) {
+        std::fill(part, part + frames, 0.0f);
+        strings(&serial, p, n, part, frames);
+        for (int i = 0; i < frames; ++i) expected[i] = p == 0 ? part[i] : expected[i] + part[i];
+      }
+      serial.time += frames;
+      for (int i = 0; i < frames; ++i) same &= std::memcmp(&mixed[i], &expected[i], sizeof(float)) == 0;
+    }
+    pool.stop();
+    printf("8 voices on 4 partitions match the serial render: %s\n", same ? "ok" : "FAIL");
+    assert(same);
+  }
+}
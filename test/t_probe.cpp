@@ -0,0 +1,97 @@
+// Checks the cycle-accounting probes. Built twice by the Makefile: with
+// KY_PROFILE=1 the counts must add up, across threads too; without it the
+// probes must cost nothing, not even space.
+#include <cstdio>
+#include <cstring>
+#include <latch>
+#include <thread>
+#include <vector>
+
+#include "../ky.h"
+
+bool check(const char* what, bool ok) {
+  printf("%-28s %s\n", what, ok ? "ok" : "FAIL");
+  return ok;
+}
+
+const ky::ProbeReport* find(const std::vector<ky::ProbeReport>& report, const char* name) {
+  for (const auto& entry : report)
+    if (std::strstr(entry.name, name) != nullptr) return &entry;
+  return nullptr;
+}
+
+void block(float* out, int n) {
+  KY_PROBE("block", n);
+  for (int i = 0; i < n; ++i) out[i] = ky::uniform();
+}
+
+int main() {
+  bool ok = true;
+  ky::Probed<ky::QuasiSaw> saw;
+  saw.frequency(220, 48000);
+  float sum = 0;
+  for (int i = 0; i < 1000; ++i) sum += saw();
+
+  std::vector<float> out(64);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([] {
+      std::vector<float> local(64);
+      for (int i = 0; i < 100; ++i) block(local.data(), 64);
+    });
+  }
+  for (auto& t : threads) t.join();
+  block(out.data(), 64);
+
+  auto report = ky::Profile::report();
+  if (ky::Profile::enabled) {
+    const auto* unit = find(report, "QuasiSaw");
+    ok &= check("unit calls", unit != nullptr && unit->calls == 1000 && unit->samples == 1000);
+    ok &= check("unit cycles", unit != nullptr && unit->cycles > 0);
+    auto* blocks = find(report, "block");
+    ok &= check("summed over threads", blocks != nullptr && blocks->calls == 401 &&
+                                           blocks->samples == 401 * 64);
+    ok &= check("busiest first", report.size() == 2 && report[0].cycles >= report[1].cycles);
+    for (const auto& entry : report)
+      printf("  %-26s %8.1f cycles per sample\n", entry.name,
+             double(entry.cycles) / double(entry.samples));
+    ky::Profile::reset();
+    report = ky::Profile::report();
+    unit = find(report, "QuasiSaw");
+    ok &= check("reset", unit != nullptr && unit->calls == 0);
+
+    // threads that come and go hand their slots on: none are lost
+    for (int t = 0; t < 4 * ky::Profile::threads; ++t) {
+      std::thread([&] { block(out.data(), 64); }).join();
+    }
+    report = ky::Profile::report();
+    blocks = find(report, "block");
+    ok &= check("slots reused", blocks != nullptr && blocks->calls == 4 * ky::Profile::threads &&
+                                    find(report, ky::Profile::droppedName) == nullptr);
+
+    // more threads alive at once than slots: the excess is counted as dropped
+    ky::Profile::reset();
+    const int crowd = ky::Profile::threads + 16;
+    std::latch alive(crowd);
+    threads.clear();
+    for (int t = 0; t < crowd; ++t) {
+      threads.emplace_back([&] {
+        std::vector<float> local(64);
+        block(local.data(), 64);
+        alive.arrive_and_wait();
+      });
+    }
+    for (auto& t : threads) t.join();
+    report = ky::Profile::report();
+    blocks = find(report, "block");
+    const auto* dropped = find(report, ky::Profile::droppedName);
+    ok &= check("dropped counted", blocks != nullptr && dropped != nullptr &&
+                                       dropped->calls >= 17 && dropped->samples == 64 * dropped->calls &&
+                                       blocks->calls + dropped->calls == crowd);
+  } else {
+    ok &= check("no space", sizeof(ky::Probed<ky::QuasiSaw>) == sizeof(ky::QuasiSaw));
+    ok &= check("empty report", report.empty());
+  }
+  ok &= check("unit still runs", sum == sum);
+  return ok ? 0 : 1;
+}
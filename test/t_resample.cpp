@@ -0,0 +1,82 @@
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "../ky.h"
+
+// a 1 kHz sine streamed from 44.1 to 48 kHz at each quality against the
+// exact sine, a tone above the new Nyquist taken an octave up, a glide
+// read from a buffer, and how long each quality takes
+double db(double x) { return 20 * std::log10(x + 1e-30); }
+
+int main() {
+  const char* names[] = {"fast", "good", "best"};
+  for (auto quality : {ky::Resampler::Fast, ky::Resampler::Good, ky::Resampler::Best}) {
+    ky::Resampler resampler;
+    resampler.configure(quality);
+    resampler.ratio(44100.0 / 48000.0);
+    int streaming = resampler.order();
+
+    // the engine renders exactly what each 64-sample host block needs
+    std::vector<float> y;
+    double phase = 0;
+    for (int b = 0; b < 750; ++b) {
+      int need = resampler.needed(64);
+      std::vector<float> in(need);
+      for (auto& v : in) {
+        v = static_cast<float>(0.5 * std::sin(2 * M_PI * phase));
+        phase += 1000.0 / 44100;
+      }
+      float out[64];
+      int made = resampler.process(in.data(), need, out, 64);
+      assert(made == 64);
+      y.insert(y.end(), out, out + 64);
+    }
+    double worst = 0;
+    for (size_t i = 4800; i < y.size(); ++i) {
+      double t = i / 48000.0;
+      worst = std::max(worst, std::fabs(y[i] - 0.5 * std::sin(2 * M_PI * 1000 * t)));
+    }
+
+    // 30 kHz at 96 kHz, read an octave up: it would alias to 36 kHz, which
+    // is past the new Nyquist, so anything left is aliasing
+    resampler.configure(quality, 2);
+    int octave = resampler.order();
+    std::vector<float> tone(96000), up(48000);
+    for (size_t i = 0; i < tone.size(); ++i) tone[i] = static_cast<float>(std::sin(2 * M_PI * 30000 * i / 96000.0));
+    resampler.read(tone.data(), tone.size(), 0, 2.0, up.data(), static_cast<int>(up.size()));
+    double alias = 0;
+    for (size_t i = 100; i < up.size() - 100; ++i) alias = std::max(alias, std::fabs(double(up[i])));
+
+    auto start = std::chrono::steady_clock::now();
+    float out[256];
+    double position = 0;
+    for (int b = 0; b < 48000 * 10 / 256; ++b) {
+      position = resampler.read(tone.data(), tone.size(), position, 1.0001, out, 256);
+      if (position > 90000) position -= 80000;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("%s: 44.1 to 48 kHz error %.1f dB (%d taps), aliasing %.1f dB (%d taps), "
+           "%.4f of real time\n",
+           names[quality], db(worst), streaming, db(alias), octave, seconds / 10);
+  }
+
+  // a glide from unison to an octave up over a second, against the exact
+  // sine of the integrated position
+  ky::Resampler resampler;
+  resampler.configure(ky::Resampler::Best, 2);
+  std::vector<float> source(200000);
+  for (size_t i = 0; i < source.size(); ++i) source[i] = static_cast<float>(std::sin(2 * M_PI * 440 * i / 48000.0));
+  std::vector<float> ratios(48000), y(48000);
+  for (int i = 0; i < 48000; ++i) ratios[i] = 1 + i / 48000.0f;
+  resampler.read(source.data(), source.size(), 1000, ratios.data(), y.data(), 48000);
+  double position = 1000, worst = 0;
+  for (int i = 0; i < 48000; ++i) {
+    worst = std::max(worst, std::fabs(y[i] - std::sin(2 * M_PI * 440 * position / 48000.0)));
+    position += ratios[i];
+  }
+  printf("glide: error %.1f dB\n", db(worst));
+}
@@ -0,0 +1,39 @@
+#include <cstdio>
+#include <vector>
+
+#include "../state.h"
+
+struct Bytes : std::vector<unsigned char> {
+  void append(const void* p, size_t n) {
+    auto* c = static_cast<const unsigned char*>(p);
+    insert(end(), c, c + n);
+  }
+};
+
+int main() {
+  Bytes bytes;
+  std::vector<float> table(1000);
+  for (size_t i = 0; i < table.size(); ++i) table[i] = i * 0.5f;
+  {
+    ky::StateWriter<Bytes> writer(bytes);
+    writer.chunk("PARM", "abc", 3);
+    writer.chunk("WAVE", table.data(), table.size() * sizeof(float), 1024);
+  }
+  printf("%zu bytes\n", bytes.size());
+
+  // the payloads are read in place, 8-byte aligned
+  ky::StateReader reader(bytes.data(), bytes.size());
+  ky::StateChunk chunk;
+  while (reader.next(chunk)) {
+    printf("%.4s part %u: %llu bytes at offset %ld\n", chunk.tag, chunk.part,
+           (unsigned long long)chunk.size, (long)(chunk.data - bytes.data()));
+  }
+
+  // a truncated buffer ends early; XML does not read as this format
+  ky::StateReader cut(bytes.data(), 100);
+  int n = 0;
+  while (cut.next(chunk)) ++n;
+  printf("%d chunk(s) from a truncated buffer\n", n);
+  const char xml[] = "VC2!<?xml version";
+  printf("%d\n", ky::StateReader(xml, sizeof(xml)).valid());
+}
@@ -0,0 +1,55 @@
+#include <cmath>
+#include <cstdio>
+
+#include "../stream.h"
+
+// write a 16-bit stereo WAV, stream it through two voices that share the
+// file, and compare what plays against what was written
+int main() {
+  const char* path = "/tmp/t_stream.wav";
+  const int frames = 48000 * 4, channels = 2;
+  {
+    FILE* f = fopen(path, "wb");
+    auto u32 = [&](uint32_t v) { fwrite(&v, 4, 1, f); };
+    auto u16 = [&](uint16_t v) { fwrite(&v, 2, 1, f); };
+    fwrite("RIFF", 1, 4, f); u32(36 + frames * channels * 2); fwrite("WAVE", 1, 4, f);
+    fwrite("fmt ", 1, 4, f); u32(16); u16(1); u16(channels); u32(48000);
+    u32(48000 * channels * 2); u16(channels * 2); u16(16);
+    fwrite("data", 1, 4, f); u32(frames * channels * 2);
+    for (int i = 0; i < frames; ++i) {
+      int16_t l = int16_t(16000 * std::sin(i * 0.05)), r = int16_t(i % 1000 * 30);
+      fwrite(&l, 2, 1, f);
+      fwrite(&r, 2, 1, f);
+    }
+    fclose(f);
+  }
+
+  auto a = ky::SampleCache::shared().open(path, 4800);
+  auto b = ky::SampleCache::shared().open(path, 4800);
+  printf("%d frames, %d channels, shared: %d\n", (int)a->frames(), a->channels(), a == b);
+
+  ky::StreamVoice one(a, 16384), two(b, 16384);
+  ky::Streamer streamer;
+  streamer.add(one);
+  streamer.add(two);
+  streamer.start();
+
+  float left[256], right[256];
+  float* out[] = {left, right};
+  double error = 0;
+  int at = 0;
+  one.start();
+  while (one.active()) {
+    for (int i = 0; i < 256; ++i) left[i] = right[i] = 0;
+    one.render(out, 2, 256);
+    for (int i = 0; i < 256 && at + i < frames; ++i) {
+      double l = int16_t(16000 * std::sin((at + i) * 0.05)) / 32768.0;
+      double r = int16_t((at + i) % 1000 * 30) / 32768.0;
+      error = std::fmax(error, std::fabs(left[i] - l) + std::fabs(right[i] - r));
+    }
+    at += 256;
+    std::this_thread::sleep_for(std::chrono::microseconds(500));
+  }
+  streamer.stop();
+  printf("played %d frames, %zu underruns, max error %g\n", std::min(at, frames), one.missed(), error);
+}